@@ -165,11 +165,13 @@ public:
 		{return name;}
 protected:
 	static bool smolyak_normal_moments(const GeneralMatrix& m, int imom, int level);
+	static bool smolyak_incremental_moments(const GeneralMatrix& m, int imom, int level);
 	static bool product_normal_moments(const GeneralMatrix& m, int imom, int level);
 	static bool qmc_normal_moments(const GeneralMatrix& m, int imom, int level);
 	static bool smolyak_product_cube(const VectorFunction& func, const Vector& res,
 									 double tol, int level);
 	static bool qmc_cube(const VectorFunction& func, double res, double tol, int level);
+	static bool sobol_cube(const VectorFunction& func, double res, double tol, int level);
 };
 
 bool TestRunnable::test() const
@@ -221,6 +223,56 @@ bool TestRunnable::smolyak_normal_moments(const GeneralMatrix& m, int imom, int
 	return smol_out.getMax() < 1.e-7;
 }
 
+bool TestRunnable::smolyak_incremental_moments(const GeneralMatrix& m, int imom, int level)
+{
+	// first make m*m' and then Cholesky factor
+	GeneralMatrix mtr(m, "transpose");
+	GeneralMatrix msq(m, mtr);
+
+	// make vector function
+	int dim = m.numRows();
+	TensorPower tp(dim, imom);
+	GaussConverterFunction func(tp, msq);
+	GaussHermite gs;
+
+	// go through the levels incrementally and from scratch
+	Vector inc_out(UFSTensor::calcMaxOffset(dim, imom));
+	Vector smol_out(inc_out.length());
+	VectorFunctionSet fs(func, num_threads);
+	IncrementalSmolyak inc(dim, gs, fs);
+	int smol_evals = 0;
+	double max_diff = 0.0;
+	{
+		WallTimer tim("\tIncremental Smolyak time:        ");
+		for (int l = 1; l <= level; l++) {
+			inc.integrate(l, inc_out);
+			SmolyakQuadrature quad(dim, l, gs);
+			quad.integrate(func, l, num_threads, smol_out);
+			smol_evals += quad.numEvals(l);
+			smol_out.add(-1.0, inc_out);
+			max_diff = std::max(max_diff, smol_out.getMax()/std::max(1.0, inc_out.getMax()));
+		}
+	}
+	printf("\tNumber of incremental evaluations: %d\n", inc.numEvals());
+	printf("\tNumber of Smolyak evaluations:   %d\n", smol_evals);
+	printf("\tDifference to Smolyak:          %16.12g\n", max_diff);
+
+	// adaptive integration from scratch
+	IncrementalSmolyak adapt(dim, gs, fs);
+	int lev;
+	double err;
+	bool conv = adapt.integrateAdaptive(1.e-8, smol_evals, inc_out, lev, err);
+	printf("\tAdaptive level, evaluations:     %d, %d\n", lev, adapt.numEvals());
+	printf("\tAdaptive error estimate:        %16.12g\n", err);
+
+	// check against theoretical moments
+	UNormalMoments moments(imom, msq);
+	inc_out.add(-1.0, (moments.get(Symmetry(imom)))->getData());
+	printf("\tError:                         %16.12g\n", inc_out.getMax());
+	return conv && inc_out.getMax() < 1.e-7 && max_diff < 1.e-12
+		&& inc.numEvals() < smol_evals;
+}
+
 bool TestRunnable::product_normal_moments(const GeneralMatrix& m, int imom, int level)
 {
 	// first make m*m' and then Cholesky factor
@@ -242,11 +294,22 @@ bool TestRunnable::product_normal_moments(const GeneralMatrix& m, int imom, int
 		printf("\tNumber of product evaluations:    %d\n", quad.numEvals(level));
 	}
 
+	// the same in the calling thread, the portions do not depend on the
+	// number of threads, so the results must be equal
+	Vector serial_out(prod_out.length());
+	{
+		GaussHermite gs;
+		ProductQuadrature quad(dim, gs);
+		quad.integrate(func, level, serial_out);
+	}
+	serial_out.add(-1.0, prod_out);
+	printf("\tSerial difference:             %16.12g\n", serial_out.getMax());
+
 	// check against theoretical moments
 	UNormalMoments moments(imom, msq);
 	prod_out.add(-1.0, (moments.get(Symmetry(imom)))->getData());
 	printf("\tError:                         %16.12g\n", prod_out.getMax());
-	return prod_out.getMax() < 1.e-7;
+	return prod_out.getMax() < 1.e-7 && serial_out.getMax() == 0.0;
 }
 
 bool TestRunnable::qmc_normal_moments(const GeneralMatrix& m, int imom, int level)
@@ -374,6 +437,38 @@ bool TestRunnable::qmc_cube(const VectorFunction& func, double res, double tol,
 	return error1 < tol && error2 < tol && error3 < tol;
 }
 
+bool TestRunnable::sobol_cube(const VectorFunction& func, double res, double tol, int level)
+{
+	Vector r(1);
+	double error1;
+	{
+		WallTimer tim("\tSobol (no scrambling) time:     ");
+		SobolCubeQuadrature sob(func.indim(), level, false);
+		sob.integrate(func, level, num_threads, r);
+		error1 = std::max(res - r[0], r[0] - res);
+		printf("\tSobol (no scrambling) error:    %16.12g\n", error1);
+	}
+	double error2;
+	{
+		WallTimer tim("\tSobol (Owen scrambling) time:   ");
+		SobolCubeQuadrature sob(func.indim(), level, true, 1);
+		sob.integrate(func, level, num_threads, r);
+		error2 = std::max(res - r[0], r[0] - res);
+		printf("\tSobol (Owen scrambling) error:  %16.12g\n", error2);
+	}
+	double error3;
+	{
+		WallTimer tim("\tHalton (no scrambling) time:    ");
+		IdentityPerScheme ips;
+		QMCarloCubeQuadrature qmc(func.indim(), level, ips);
+		qmc.integrate(func, level, num_threads, r);
+		error3 = std::max(res - r[0], r[0] - res);
+		printf("\tHalton (no scrambling) error:   %16.12g\n", error3);
+	}
+
+	return error1 < tol && error2 < tol;
+}
+
 /****************************************************/
 /*     definition of TestRunnable subclasses        */
 /****************************************************/
@@ -405,6 +500,21 @@ public:
 		}
 };
 
+class SmolyakIncrementalMom : public TestRunnable {
+public:
+	SmolyakIncrementalMom()
+		: TestRunnable("Incremental Smolyak normal moments (dim=3, level=6, order=4)", 4, 3) {}
+
+	bool run() const
+		{
+			GeneralMatrix m(3,3);
+			m.zeros();
+			m.get(0,0)=1; m.get(0,2)=0.5; m.get(1,1)=1;
+			m.get(1,0)=0.5;m.get(2,2)=2;m.get(2,1)=4;
+			return smolyak_incremental_moments(m, 4, 6);
+		}
+};
+
 class ProductNormalMom1 : public TestRunnable {
 public:
 	ProductNormalMom1()
@@ -490,6 +600,18 @@ public:
 		}
 };
 
+class F1Sobol : public TestRunnable {
+public:
+	F1Sobol()
+		: TestRunnable("Function1 Sobol (dim=30, level=65536)", 1, 1) {}
+
+	bool run() const
+		{
+			Function1 f1(30);
+			return sobol_cube(f1, 1.0, 5.e-4, 65536);
+		}
+};
+
 int main()
 {
 	TestRunnable* all_tests[50];
@@ -497,10 +619,12 @@ int main()
 	int num_tests = 0;
 	all_tests[num_tests++] = new SmolyakNormalMom1();
 	all_tests[num_tests++] = new SmolyakNormalMom2();
+	all_tests[num_tests++] = new SmolyakIncrementalMom();
 	all_tests[num_tests++] = new ProductNormalMom1();
 	all_tests[num_tests++] = new ProductNormalMom2();
 	all_tests[num_tests++] = new QMCNormalMom1();
 	all_tests[num_tests++] = new QMCNormalMom2();
+	all_tests[num_tests++] = new F1Sobol();
 /*
 	all_tests[num_tests++] = new F1GaussLegendre();
 	all_tests[num_tests++] = new F1QuasiMCarlo();
@@ -2,7 +2,11 @@
 /* Copyright 2004, Ondra Kamenik */
 
 #include <cstdlib>
+#include <cmath>
 #include "korder.h"
+#include "decision_rule.h"
+#include "approximation.h"
+#include "kord_exception.h"
 #include "SylvException.h"
 
 struct Rand {
@@ -209,6 +213,121 @@ const double gu_data2 [] = { // raw data 300 items
 	0.67878, 0.42776, 0.61454, 0.55915, 0.36363, 0.31999, 0.42442, 0.86649, 0.62513, 0.02047
 };
 
+// a small model with one predetermined variable k and one forward
+// looking variable c; the stack of the derivatives is
+// (c(+1), k, c, k(-1), u):
+//   k = rho*k(-1) + delta*(exp(c)-1) + u
+//   exp(c) = beta*exp(gamma*c(+1)) + (1-beta)*exp(theta*k)
+class WalkNameList : public NameList {
+	int num;
+	const char** names;
+public:
+	WalkNameList(int n, const char** nms)
+		: num(n), names(nms) {}
+	int getNum() const
+		{return num;}
+	const char* getName(int i) const
+		{return names[i];}
+};
+
+class WalkModel : public DynamicModel {
+	static const char* endo_names[];
+	static const char* state_names[];
+	static const char* exo_names[];
+	WalkNameList endo;
+	WalkNameList states;
+	WalkNameList exo;
+	double rho, delta, beta, gamma, theta;
+	int ord;
+	TwoDMatrix vcov;
+	TensorContainer<FSSparseTensor> md;
+	Vector steady;
+public:
+	WalkModel(double r, double dl, double b, double g, double th, double sig, int o)
+		: endo(2, endo_names), states(1, state_names), exo(1, exo_names),
+		  rho(r), delta(dl), beta(b), gamma(g), theta(th), ord(o), vcov(1, 1), md(1), steady(2)
+		{vcov.get(0, 0) = sig*sig; steady.zeros();}
+	WalkModel(const WalkModel& m)
+		: endo(m.endo), states(m.states), exo(m.exo),
+		  rho(m.rho), delta(m.delta), beta(m.beta), gamma(m.gamma), theta(m.theta), ord(m.ord),
+		  vcov(m.vcov), md(m.md), steady((const Vector&)m.steady) {}
+	DynamicModel* clone() const
+		{return new WalkModel(*this);}
+	int nstat() const
+		{return 0;}
+	int nboth() const
+		{return 0;}
+	int npred() const
+		{return 1;}
+	int nforw() const
+		{return 1;}
+	int nexog() const
+		{return 1;}
+	int order() const
+		{return ord;}
+	const NameList& getAllEndoNames() const
+		{return endo;}
+	const NameList& getStateNames() const
+		{return states;}
+	const NameList& getExogNames() const
+		{return exo;}
+	const TwoDMatrix& getVcov() const
+		{return vcov;}
+	const TensorContainer<FSSparseTensor>& getModelDerivatives() const
+		{return md;}
+	const Vector& getSteady() const
+		{return steady;}
+	Vector& getSteady()
+		{return steady;}
+	void setTheta(double th)
+		{theta = th;}
+	void solveDeterministicSteady()
+		{
+			// k = 0 and c = 0 solve both equations
+			steady.zeros();
+		}
+	void evaluateSystem(Vector& out, const Vector& yy, const Vector& xx)
+		{
+			Vector yym(1);
+			yym[0] = yy[0];
+			Vector yyp(1);
+			yyp[0] = yy[1];
+			evaluateSystem(out, yym, yy, yyp, xx);
+		}
+	void evaluateSystem(Vector& out, const Vector& yym, const Vector& yy,
+						const Vector& yyp, const Vector& xx)
+		{
+			out[0] = yy[0] - rho*yym[0] - delta*(exp(yy[1])-1) - xx[0];
+			out[1] = exp(yy[1]) - beta*exp(gamma*yyp[0]) - (1-beta)*exp(theta*yy[0]);
+		}
+	void calcDerivativesAtSteady()
+		{
+			md.clear();
+			double k = steady[0];
+			double c = steady[1];
+			for (int d = 1; d <= ord; d++) {
+				FSSparseTensor* t = new FSSparseTensor(d, 5, 2);
+				IntSequence cp(d, 0);   // c(+1)
+				IntSequence kk(d, 1);   // k
+				IntSequence cc(d, 2);   // c
+				t->insert(cp, 1, -beta*pow(gamma, d)*exp(gamma*c));
+				t->insert(kk, 1, -(1-beta)*pow(theta, d)*exp(theta*k));
+				t->insert(cc, 1, exp(c));
+				t->insert(cc, 0, -delta*exp(c));
+				if (d == 1) {
+					t->insert(kk, 0, 1.0);
+					t->insert(IntSequence(1, 3), 0, -rho);
+					t->insert(IntSequence(1, 4), 0, -1.0);
+				}
+				md.insert(t);
+			}
+		}
+};
+
+const char* WalkModel::endo_names[] = {"k", "c"};
+const char* WalkModel::state_names[] = {"k"};
+const char* WalkModel::exo_names[] = {"u"};
+
 class TestRunnable {
 	char name[100];
 public:
@@ -226,6 +345,14 @@ protected:
 									 int nstat, int npred, int nboth, int forw,
 									 const TwoDMatrix& gy, const TwoDMatrix& gu,
 									 const TwoDMatrix& v);
+	static double dr_save_load(int maxdim, int nstat, int npred, int nboth,
+							   int nforw, int nu, int npoints);
+	static double walk_twice(int maxdim, int steps, double sig,
+							 double theta1, double theta2);
+	static double walk_diff(const Approximation& app1, const Approximation& app2);
+	static double walk_refined(int maxdim, int steps, double sig,
+							   double delta, double theta);
+	static double walk_zero_steps(int maxdim, double sig);
 };
 
 
@@ -308,6 +435,201 @@ double TestRunnable::korder_unfold_fold(int maxdim, int unfold_dim,
 	return maxerror;
 }
 
+double TestRunnable::dr_save_load(int maxdim, int nstat, int npred, int nboth,
+								  int nforw, int nu, int npoints)
+{
+	PartitionY yp(nstat, npred, nboth, nforw);
+	int ny = yp.ny();
+	int nv = yp.nys()+nu;
+	FTensorPolynomial pol(ny, nv);
+	for (int d = 0; d <= maxdim; d++) {
+		FFSTensor* t = new FFSTensor(ny, nv, d);
+		for (int i = 0; i < t->getData().length(); i++)
+			t->getData()[i] = Rand::get(1.0/(d+1));
+		pol.insert(t);
+	}
+	Vector ys(ny);
+	for (int i = 0; i < ny; i++)
+		ys[i] = Rand::get(1.0);
+	FoldDecisionRule fdr(pol, yp, nu, ys);
+	UnfoldDecisionRule udr(fdr);
+	const DecisionRule& fdr_orig = fdr;
+	const DecisionRule& udr_orig = udr;
+	fdr_orig.save("dr_fold.bin");
+	udr_orig.save("dr_unfold.bin");
+	DecisionRule* fdr_load = DecisionRule::load("dr_fold.bin");
+	DecisionRule* udr_load = DecisionRule::load("dr_unfold.bin");
+
+	double maxerror = 0.0;
+	Vector x(nv);
+	Vector out(ny);
+	Vector out_load(ny);
+	for (int ip = 0; ip < npoints; ip++) {
+		for (int i = 0; i < nv; i++)
+			x[i] = Rand::get(1.0);
+		fdr_orig.eval(DecisionRule::horner, out, x);
+		fdr_load->eval(DecisionRule::horner, out_load, x);
+		out_load.add(-1.0, out);
+		maxerror = std::max(maxerror, out_load.getMax());
+		udr_orig.eval(DecisionRule::trad, out, x);
+		udr_load->eval(DecisionRule::trad, out_load, x);
+		out_load.add(-1.0, out);
+		maxerror = std::max(maxerror, out_load.getMax());
+	}
+	out_load = fdr_load->getSteady();
+	out_load.add(-1.0, ys);
+	maxerror = std::max(maxerror, out_load.getMax());
+	printf("\tmax error of loaded rules:    %10.6g\n", maxerror);
+	delete fdr_load;
+	delete udr_load;
+
+	// a truncated file must be refused
+	FILE* fd = fopen("dr_fold.bin", "r+b");
+	fseek(fd, -(long)sizeof(double), SEEK_END);
+	long len = ftell(fd);
+	rewind(fd);
+	char* buf = new char[len];
+	bool read = (fread(buf, 1, len, fd) == (size_t)len);
+	fclose(fd);
+	fd = fopen("dr_fold.bin", "wb");
+	fwrite(buf, 1, len, fd);
+	fclose(fd);
+	delete [] buf;
+	bool refused = false;
+	try {
+		delete DecisionRule::load("dr_fold.bin");
+	} catch (const KordException& e) {
+		refused = true;
+	}
+	printf("\ttruncated file refused:       %s\n", refused? "yes" : "no");
+	if (! read || ! refused)
+		maxerror = 1.0;
+	return maxerror;
+}
+
+double TestRunnable::walk_diff(const Approximation& app1, const Approximation& app2)
+{
+	TwoDMatrix dss(app1.getSS());
+	dss.add(-1.0, app2.getSS());
+	double res = dss.getData().getMax();
+	const FoldDecisionRule& dr1 = app1.getFoldDecisionRule();
+	const FoldDecisionRule& dr2 = app2.getFoldDecisionRule();
+	for (int i = 0; i < 5; i++) {
+		Vector ys(1);
+		ys[0] = dr2.getSteady()[0] + 0.05*(i-2);
+		Vector u(1);
+		u[0] = 0.02*(2-i);
+		Vector out1(2);
+		Vector out2(2);
+		dr1.evaluate(DecisionRule::horner, out1, ys, u);
+		dr2.evaluate(DecisionRule::horner, out2, ys, u);
+		out1.add(-1.0, out2);
+		if (res < out1.getMax())
+			res = out1.getMax();
+	}
+	return res;
+}
+
+double TestRunnable::walk_twice(int maxdim, int steps, double sig,
+								double theta1, double theta2)
+{
+	Journal journal("kord_walk.jnl");
+	WalkModel model(0.9, 0.1, 0.95, 0.5, theta1, sig, maxdim);
+	Approximation app(model, journal, steps, false, 1.0+1.e-6);
+	app.setIncremental(true);
+
+	// the first walk has nothing to reuse
+	app.walkStochSteady();
+	WalkModel model1(0.9, 0.1, 0.95, 0.5, theta1, sig, maxdim);
+	Approximation app1(model1, journal, steps, false, 1.0+1.e-6);
+	app1.walkStochSteady();
+	double err1 = walk_diff(app, app1);
+
+	// the second walk is started from the shifts of the first
+	model.setTheta(theta2);
+	app.walkStochSteady();
+	WalkModel model2(0.9, 0.1, 0.95, 0.5, theta2, sig, maxdim);
+	Approximation app2(model2, journal, steps, false, 1.0+1.e-6);
+	app2.walkStochSteady();
+	double err2 = walk_diff(app, app2);
+
+	printf("\tstochastic steady of k and c:  %10.6g %10.6g\n",
+		   app.getSS().get(0, steps), app.getSS().get(1, steps));
+	printf("\terror of the first walk:       %10.6g\n", err1);
+	printf("\terror of the second walk:      %10.6g\n", err2);
+	return std::max(err1, err2);
+}
+
+double TestRunnable::walk_refined(int maxdim, int steps, double sig,
+								  double delta, double theta)
+{
+	Journal journal("kord_walk.jnl");
+
+	// the walk with the fixed steps must fail
+	WalkModel model1(0.9, delta, 0.95, 0.5, theta, sig, maxdim);
+	Approximation app1(model1, journal, steps, false, 1.0+1.e-6);
+	bool failed = false;
+	try {
+		app1.walkStochSteady();
+	} catch (const KordException& e) {
+		failed = (e.code() == KORD_FP_NOT_FINITE || e.code() == KORD_FP_NOT_CONV);
+	}
+
+	// the adaptive walk with a tolerance it never meets must get to
+	// sigma=1 by refining the steps
+	WalkModel model(0.9, delta, 0.95, 0.5, theta, sig, maxdim);
+	Approximation app(model, journal, steps, false, 1.0+1.e-6);
+	app.setWalkTolerance(1.e-14);
+	app.walkStochSteady();
+
+	// the last steady must be the fix point of the rule
+	ConstVector yfix(app.getSS(), steps);
+	Vector ys(1);
+	ys[0] = yfix[0];
+	Vector u(1);
+	u.zeros();
+	Vector out(2);
+	app.getFoldDecisionRule().evaluate(DecisionRule::horner, out, ys, u);
+	out.add(-1.0, yfix);
+	double err = out.getMax();
+
+	printf("	fixed steps failed:            %s\n", failed? "yes" : "no");
+	printf("	stochastic steady of k and c:  %10.6g %10.6g\n", yfix[0], yfix[1]);
+	printf("	error of the fix point:        %10.6g\n", err);
+	if (! failed || ! yfix.isFinite())
+		err = 1.0;
+	return err;
+}
+
+double TestRunnable::walk_zero_steps(int maxdim, double sig)
+{
+	Journal journal("kord_walk.jnl");
+
+	// with zero steps the tolerance must not make any difference
+	WalkModel model0(0.9, 0.1, 0.95, 0.5, 1.0, sig, maxdim);
+	Approximation app0(model0, journal, 0, false, 1.0+1.e-6);
+	app0.walkStochSteady();
+	WalkModel model(0.9, 0.1, 0.95, 0.5, 1.0, sig, maxdim);
+	Approximation app(model, journal, 0, false, 1.0+1.e-6);
+	app.setWalkTolerance(1.e-6);
+	app.walkStochSteady();
+	double err = walk_diff(app, app0);
+
+	// the only column of ss is the deterministic steady state
+	Vector det(2);
+	model.solveDeterministicSteady();
+	det = (const Vector&)model.getSteady();
+	det.add(-1.0, ConstVector(app.getSS(), 0));
+
+	printf("	steady of k and c:             %10.6g %10.6g\n",
+		   app.getSS().get(0, 0), app.getSS().get(1, 0));
+	printf("	error against the fixed walk:  %10.6g\n", err);
+	printf("	error of the column 0:         %10.6g\n", det.getMax());
+	if (app.getSS().ncols() != 1 || det.getMax() != 0.0)
+		err = 1.0;
+	return err;
+}
+
 class UnfoldKOrderSmall : public TestRunnable {
 public:
 	UnfoldKOrderSmall()
@@ -367,6 +689,58 @@ public:
 		}
 };
 
+class DecisionRuleSaveLoad : public TestRunnable {
+public:
+	DecisionRuleSaveLoad()
+		: TestRunnable("save and load decision rule (stat=2,pred=3,both=1,forw=2,u=3,dim=4)",
+					   4, 7) {}
+
+	bool run() const
+		{
+			double err = dr_save_load(4, 2, 3, 1, 2, 3, 100);
+			return err < 1.e-12;
+		}
+};
+
+class IncrementalWalk : public TestRunnable {
+public:
+	IncrementalWalk()
+		: TestRunnable("incremental walk with perturbed parameter (pred=1,forw=1,u=1,dim=2)",
+					   2, 5) {}
+
+	bool run() const
+		{
+			double err = walk_twice(2, 10, 0.3, 1.0, 1.05);
+			return err < 1.e-8;
+		}
+};
+
+class RefinedWalk : public TestRunnable {
+public:
+	RefinedWalk()
+		: TestRunnable("adaptive walk with refined steps (pred=1,forw=1,u=1,dim=2)",
+					   2, 5) {}
+
+	bool run() const
+		{
+			double err = walk_refined(2, 10, 2.0, 0.5, -1.0);
+			return err < 1.e-8;
+		}
+};
+
+class ZeroStepsWalk : public TestRunnable {
+public:
+	ZeroStepsWalk()
+		: TestRunnable("zero steps with walk tolerance (pred=1,forw=1,u=1,dim=2)",
+					   2, 5) {}
+
+	bool run() const
+		{
+			double err = walk_zero_steps(2, 0.3);
+			return err == 0.0;
+		}
+};
+
 int main()
 {
 	TestRunnable* all_tests[50];
@@ -375,6 +749,10 @@ int main()
 	all_tests[num_tests++] = new UnfoldKOrderSmall();
 	all_tests[num_tests++] = new UnfoldKOrderSW();
 	all_tests[num_tests++] = new UnfoldFoldKOrderSW();
+	all_tests[num_tests++] = new DecisionRuleSaveLoad();
+	all_tests[num_tests++] = new IncrementalWalk();
+	all_tests[num_tests++] = new RefinedWalk();
+	all_tests[num_tests++] = new ZeroStepsWalk();
 
 	// find maximum dimension and maximum nvar
 	int dmax=0;
@@ -399,6 +777,9 @@ int main()
 		} catch (SylvException& e) {
 			printf("Caught Sylv exception in <%s>:\n", all_tests[i]->getName());
 			e.printMessage();
+		} catch (const KordException& e) {
+			printf("Caught Kord exception in <%s>:\n", all_tests[i]->getName());
+			e.print();
 		}
 	}
 
@@ -38,6 +38,32 @@ void FormulaParser::differentiate(int max_order)
 		ders.push_back(new FormulaDerivatives(otree, vars, formulas[i], max_order));
 }
 
+FormulaDerivatives* FormulaParser::differentiate_local(OperationTree& local,
+														const vector<int>& vars,
+														int i, int max_order,
+														TreePatch& patch) const
+{
+	local.start_patch();
+	FormulaDerivatives* fder = new FormulaDerivatives(local, vars, formulas[i], max_order);
+	local.end_patch(patch);
+	return fder;
+}
+
+void FormulaParser::merge_derivatives(const vector<FormulaDerivatives*>& fders,
+									  const vector<TreePatch>& patches)
+{
+	if (fders.size() != formulas.size() || patches.size() != formulas.size())
+		throw ogu::Exception(__FILE__,__LINE__,
+							 "Wrong number of derivatives in FormulaParser::merge_derivatives");
+	destroy_derivatives();
+	vector<int> map;
+	for (unsigned int i = 0; i < formulas.size(); i++) {
+		otree.apply_patch(patches[i], map);
+		fders[i]->remap(patches[i], map);
+		ders.push_back(fders[i]);
+	}
+}
+
 const FormulaDerivatives& FormulaParser::derivatives(int i) const
 {
 	if (i < (int)ders.size())
@@ -236,6 +262,13 @@ FormulaDerivatives::FormulaDerivatives(const FormulaDerivatives& fd)
 {
 }
 
+void FormulaDerivatives::remap(const TreePatch& p, const vector<int>& map)
+{
+	for (unsigned int i = 0; i < tder.size(); i++)
+		if (tder[i] >= p.base)
+			tder[i] = map[tder[i]-p.base];
+}
+
 int FormulaDerivatives::derivative(const FoldMultiIndex& mi) const
 {
 	if (mi.order() > order)
@@ -268,7 +301,7 @@ void FormulaCustomEvaluator::eval(const AtomValues& av, FormulaEvalLoader& loade
 	etree.reset_all();
 	av.setValues(etree);
 	for (unsigned int i = 0; i < terms.size(); i++) {
-		double res = etree.eval(terms[i]);
+		double res = tape.eval(etree, i);
 		loader.load((int)i, res);
 	}
 }
@@ -437,7 +470,7 @@ bool ltfmi::operator()(const FoldMultiIndex& i1, const FoldMultiIndex& i2) const
 
 
 FormulaDerEvaluator::FormulaDerEvaluator(const FormulaParser& fp)
-	: etree(fp.otree, -1)
+	: etree(fp.otree, -1), sel_tape(NULL), sel_order(-1)
 {
 	for (unsigned int i = 0; i < fp.ders.size(); i++)
 		ders.push_back((const FormulaDerivatives*)(fp.ders[i]));
@@ -445,50 +478,50 @@ FormulaDerEvaluator::FormulaDerEvaluator(const FormulaParser& fp)
 	der_atoms = fp.atoms.variables();
 }
 
-void FormulaDerEvaluator::eval(const AtomValues& av, FormulaDerEvalLoader& loader, int order)
+FormulaDerEvaluator::~FormulaDerEvaluator()
 {
-	if (ders.size() == 0)
-		return;
-	int maxorder = ders[0]->order;
-
-	if (order > maxorder)
-		throw ogu::Exception(__FILE__,__LINE__,
-							 "Wrong order in FormulaDerEvaluator::eval");
-
-	etree.reset_all();
-	av.setValues(etree);
-
-	int* vars = new int[order];
+	for (unsigned int i = 0; i < tapes.size(); i++)
+		if (tapes[i])
+			delete tapes[i];
+	if (sel_tape)
+		delete sel_tape;
+}
 
-	for (unsigned int i = 0; i < ders.size(); i++) {
-		for (FormulaDerivatives::Tfmiintmap::const_iterator it = ders[i]->ind2der.begin();
-			 it != ders[i]->ind2der.end(); ++it) {
-			const FoldMultiIndex& mi = (*it).first;
-			if (mi.order() == order) {
-				// set vars from multiindex mi and variables
-				for (int k = 0; k < order; k++)
-					vars[k] = der_atoms[mi[k]];
-				// evaluate
-				double res = etree.eval(ders[i]->tder[(*it).second]);
-				// load
-				loader.load(i, order, vars, res);
+const EvalTape& FormulaDerEvaluator::get_tape(int order)
+{
+	if ((int)tapes.size() <= order) {
+		tapes.resize(order+1, NULL);
+		der_formula.resize(order+1);
+		der_vars.resize(order+1);
+	}
+	if (! tapes[order]) {
+		vector<int> ts;
+		for (unsigned int i = 0; i < ders.size(); i++)
+			for (FormulaDerivatives::Tfmiintmap::const_iterator it = ders[i]->ind2der.begin();
+				 it != ders[i]->ind2der.end(); ++it) {
+				const FoldMultiIndex& mi = (*it).first;
+				if (mi.order() == order) {
+					ts.push_back(ders[i]->tder[(*it).second]);
+					der_formula[order].push_back(i);
+					for (int k = 0; k < order; k++)
+						der_vars[order].push_back(der_atoms[mi[k]]);
+				}
 			}
-		}
+		tapes[order] = new EvalTape(etree.getOperationTree(), ts);
 	}
-
-	delete [] vars;
+	return *(tapes[order]);
 }
 
-void FormulaDerEvaluator::eval(const vector<int>& mp, const AtomValues& av,
-							   FormulaDerEvalLoader& loader, int order)
+const EvalTape& FormulaDerEvaluator::get_tape(const vector<int>& mp, int order)
 {
-	etree.reset_all();
-	av.setValues(etree);
+	if (sel_tape && sel_order == order && sel_mp == mp)
+		return *sel_tape;
 
 	int nvar_glob = der_atoms.size();
 	int nvar = mp.size();
-	int* vars = new int[order];
-
+	vector<int> ts;
+	sel_formula.clear();
+	sel_vars.clear();
 	for (unsigned int i = 0; i < ders.size(); i++) {
 		FoldMultiIndex mi(nvar, order);
 		do {
@@ -496,19 +529,59 @@ void FormulaDerEvaluator::eval(const vector<int>& mp, const AtomValues& av,
 			FoldMultiIndex mi_glob(nvar_glob, mi, mp);
 			int der = ders[i]->derivative(mi_glob);
 			if (der != OperationTree::zero) {
-				// set vars from the global multiindex
+				ts.push_back(der);
+				sel_formula.push_back(i);
 				for (int k = 0; k < order; k++)
-					vars[k] = der_atoms[mi_glob[k]];
-				// evaluate derivative
-				double res = etree.eval(der);
-				// load
-				loader.load(i, order, vars, res);
+					sel_vars.push_back(der_atoms[mi_glob[k]]);
 			}
 			mi.increment();
 		} while (! mi.past_the_end());
 	}
+	if (sel_tape)
+		delete sel_tape;
+	sel_tape = new EvalTape(etree.getOperationTree(), ts);
+	sel_mp = mp;
+	sel_order = order;
+	return *sel_tape;
+}
+
+/** All derivatives of the order are evaluated by one sweep of the
+ * tape, and passed to the loader at once. */
+void FormulaDerEvaluator::eval(const AtomValues& av, FormulaDerEvalLoader& loader, int order)
+{
+	if (ders.size() == 0)
+		return;
+	int maxorder = ders[0]->order;
+
+	if (order > maxorder)
+		throw ogu::Exception(__FILE__,__LINE__,
+							 "Wrong order in FormulaDerEvaluator::eval");
+
+	const EvalTape& tape = get_tape(order);
+	etree.reset_all();
+	av.setValues(etree);
+	res.resize(tape.nterms());
+	if (res.size() == 0)
+		return;
+	tape.eval(etree, &(res[0]));
+
+	loader.load_all(order, (int)res.size(), &(der_formula[order][0]),
+					order > 0 ? &(der_vars[order][0]) : NULL, &(res[0]));
+}
+
+void FormulaDerEvaluator::eval(const vector<int>& mp, const AtomValues& av,
+							   FormulaDerEvalLoader& loader, int order)
+{
+	const EvalTape& tape = get_tape(mp, order);
+	etree.reset_all();
+	av.setValues(etree);
+	res.resize(tape.nterms());
+	if (res.size() == 0)
+		return;
+	tape.eval(etree, &(res[0]));
 
-	delete [] vars;
+	loader.load_all(order, (int)res.size(), &(sel_formula[0]),
+					order > 0 ? &(sel_vars[0]) : NULL, &(res[0]));
 }
 
 
@@ -77,6 +77,7 @@ namespace ogp
   class FormulaDerivatives
   {
     friend class FormulaDerEvaluator;
+    friend class FormulaNativeEvaluator;
   protected:
     /** Vector of derivatives. This is a list of derivatives (tree
      * indices), the ordering is given by the algorithm used to
@@ -116,6 +117,11 @@ namespace ogp
     }
     /** Random access to the derivatives via multiindex. */
     int derivative(const FoldMultiIndex &mi) const;
+    /** Change the tree indices of the derivatives from a tree
+     * where the patch was recorded to a tree where it was
+     * applied with the given map (see
+     * OperationTree::apply_patch). */
+    void remap(const TreePatch &p, const vector<int> &map);
     /** Return the order. */
     int
     get_order() const
@@ -142,6 +148,7 @@ namespace ogp
   {
     friend class FormulaCustomEvaluator;
     friend class FormulaDerEvaluator;
+    friend class FormulaNativeEvaluator;
   protected:
     /** The OperationTree of all formulas, including derivatives. */
     OperationTree otree;
@@ -221,9 +228,9 @@ namespace ogp
     {
       otree.nularify(t);
     }
-    /** Returns a set of nulary terms of the given term. Just
-     * calls OperationTree::nulary_of_term. */
-    const unordered_set<int> &
+    /** Returns a sorted list of nulary terms of the given
+     * term. Just calls OperationTree::nulary_of_term. */
+    NularySpan
     nulary_of_term(int t) const
     {
       return otree.nulary_of_term(t);
@@ -241,6 +248,22 @@ namespace ogp
      * they are destroyed and created again (with possibly
      * different order). */
     void differentiate(int max_order);
+    /** Differentiate the i-th formula up to the given order in
+     * the given copy of the tree. The copy is left unchanged, the
+     * new terms are stored in the patch, and the returned
+     * derivatives refer to the copy. This does not change the
+     * object, so it can be run concurrently for more formulas,
+     * each thread having its own copy of the tree. */
+    FormulaDerivatives *differentiate_local(OperationTree &local, const vector<int> &vars,
+                                            int i, int max_order, TreePatch &patch) const;
+    /** Merge the results of differentiate_local() for all the
+     * formulas (in the order of formulas) to the tree and set
+     * them as the derivatives of the formulas. The object takes
+     * the ownership of the derivatives. The terms are added in
+     * the order of formulas, so the tree indices do not depend on
+     * how the differentiation was scheduled. */
+    void merge_derivatives(const vector<FormulaDerivatives *> &fders,
+                           const vector<TreePatch> &patches);
     /** Return i-th formula derivatives. */
     const FormulaDerivatives&derivatives(int i) const;
 
@@ -334,15 +357,17 @@ namespace ogp
     EvalTree etree;
     /** The custom tree indices to be evaluated. */
     vector<int> terms;
+    /** The evaluation tape of the terms. */
+    EvalTape tape;
   public:
     /** Construct from FormulaParser and given list of terms. */
     FormulaCustomEvaluator(const FormulaParser &fp, const vector<int> &ts)
-      : etree(fp.otree), terms(ts)
+      : etree(fp.otree), terms(ts), tape(fp.otree, ts)
     {
     }
     /** Construct from OperationTree and given list of terms. */
     FormulaCustomEvaluator(const OperationTree &ot, const vector<int> &ts)
-      : etree(ot), terms(ts)
+      : etree(ot), terms(ts), tape(ot, ts)
     {
     }
     /** Evaluate the terms using the given AtomValues and load the
@@ -351,7 +376,8 @@ namespace ogp
     void eval(const AtomValues &av, FormulaEvalLoader &loader);
   protected:
     FormulaCustomEvaluator(const FormulaParser &fp)
-      : etree(fp.otree, fp.last_formula()), terms(fp.formulas)
+      : etree(fp.otree, fp.last_formula()), terms(fp.formulas),
+        tape(fp.otree, fp.formulas, fp.last_formula())
     {
     }
   };
@@ -383,6 +409,17 @@ namespace ogp
      * memory pointed by vars. These are the tree indices of the
      * variables. */
     virtual void load(int i, int order, const int *vars, double res) = 0;
+    /** This loads n results of the derivatives of the given order
+     * at once. The k-th result is of the formula formulas[k] and
+     * its variables are stored at vars+k*order. The default
+     * implementation calls load() for each result, a loader
+     * should override it if it can store the results in bulk. */
+    virtual void
+    load_all(int order, int n, const int *formulas, const int *vars, const double *res)
+    {
+      for (int k = 0; k < n; k++)
+        load(formulas[k], order, vars+k*order, res[k]);
+    }
   };
 
   /** This class is a utility class representing the tensor
@@ -477,9 +514,32 @@ namespace ogp
     /** A copy of tree indices corresponding to atoms to with
      * respect the derivatives were taken. */
     vector<int> der_atoms;
+    /** The evaluation tapes of all derivatives of a given order,
+     * tapes[order] is built on the first call of eval() for the
+     * order. */
+    vector<EvalTape *> tapes;
+    /** For each order, the formula of each term of the tape. */
+    vector<vector<int> > der_formula;
+    /** For each order, the tree indices of the atoms wrt which
+     * each term of the tape was taken, order indices per term. */
+    vector<vector<int> > der_vars;
+    /** The evaluation tape for the last selection and order
+     * evaluated by eval() with the selection. */
+    EvalTape *sel_tape;
+    /** The formulas of the terms of sel_tape. */
+    vector<int> sel_formula;
+    /** The variables of the terms of sel_tape. */
+    vector<int> sel_vars;
+    /** The selection of sel_tape. */
+    vector<int> sel_mp;
+    /** The order of sel_tape. */
+    int sel_order;
+    /** The values of the terms of the last evaluated tape. */
+    vector<double> res;
   public:
     /** Construct the object from FormulaParser. */
     FormulaDerEvaluator(const FormulaParser &fp);
+    virtual ~FormulaDerEvaluator();
     /** Evaluate the derivatives from the FormulaParser wrt to all
      * atoms in variables vector at the given AtomValues. The
      * given loader is used for output. */
@@ -490,6 +550,16 @@ namespace ogp
      * mapping to the indices (not values) of the der_atoms. */
     void eval(const vector<int> &mp, const AtomValues &av, FormulaDerEvalLoader &loader,
               int order);
+  protected:
+    /** Return the tape of all derivatives of the given order and
+     * set der_formula and der_vars of the order. The terms are in
+     * the order in which eval() loads them. */
+    const EvalTape &get_tape(int order);
+    /** Return the tape of derivatives of the given order wrt the
+     * given selection and set sel_formula and sel_vars. */
+    const EvalTape &get_tape(const vector<int> &mp, int order);
+  private:
+    FormulaDerEvaluator(const FormulaDerEvaluator &);
   };
 };
 
@@ -0,0 +1,398 @@
+// Copyright (C) 2005-2011, Ondra Kamenik
+
+#include "utils/cc/exception.h"
+
+#include "native_evaluator.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+#if !defined(__MINGW32__)
+# include <dlfcn.h>
+# include <unistd.h>
+#endif
+
+using namespace ogp;
+
+FormulaNativeEvaluator::FormulaNativeEvaluator(const FormulaParser& fp, const char* cache_dir)
+	: etree(fp.otree, -1), formulas(fp.formulas), maxorder(0),
+	  atom_pos(fp.otree.get_num_op(), -1), natoms(0), handle(NULL),
+	  values(NULL), out(NULL)
+{
+#if defined(__MINGW32__)
+	throw ogu::Exception(__FILE__,__LINE__,
+						 "Native evaluation not supported on this platform");
+#else
+	if (fp.ders.size() > 0)
+		maxorder = fp.ders[0]->get_order();
+
+	// targets of the zero order are the formulas
+	targets.resize(maxorder+1);
+	der_formula.resize(maxorder+1);
+	der_vars.resize(maxorder+1);
+	targets[0] = formulas;
+
+	// targets of higher orders in the ordering of FormulaDerEvaluator::eval
+	vector<int> der_atoms = fp.atoms.variables();
+	for (unsigned int i = 0; i < fp.ders.size(); i++) {
+		const FormulaDerivatives& fder = *(fp.ders[i]);
+		for (FormulaDerivatives::Tfmiintmap::const_iterator it = fder.ind2der.begin();
+			 it != fder.ind2der.end(); ++it) {
+			const FoldMultiIndex& mi = (*it).first;
+			int ord = mi.order();
+			if (ord > 0 && ord <= maxorder) {
+				targets[ord].push_back(fder.tder[(*it).second]);
+				der_formula[ord].push_back(i);
+				for (int k = 0; k < ord; k++)
+					der_vars[ord].push_back(der_atoms[mi[k]]);
+			}
+		}
+	}
+
+	// assign positions to atoms
+	atoms.resize(maxorder+1);
+	for (int ord = 0; ord <= maxorder; ord++) {
+		vector<int> ops;
+		collect(ord, ops, atoms[ord]);
+		for (unsigned int j = 0; j < atoms[ord].size(); j++)
+			if (atom_pos[atoms[ord][j]] == -1)
+				atom_pos[atoms[ord][j]] = natoms++;
+	}
+
+	// write the source to a temporary file and read it back
+	FILE* fd = tmpfile();
+	if (fd == NULL)
+		throw ogu::Exception(__FILE__,__LINE__,
+							 "Cannot open temporary file in FormulaNativeEvaluator constructor");
+	write_source(fd);
+	string source;
+	rewind(fd);
+	char buf[4096];
+	size_t nread;
+	while (0 < (nread = fread(buf, 1, sizeof(buf), fd)))
+		source.append(buf, nread);
+	fclose(fd);
+
+	// make the library name from the hash, compile if not cached
+	char hex[32];
+	sprintf(hex, "%016llx", hash(source));
+	libname = string(cache_dir) + "/dynpp_" + hex + ".so";
+	if (access(libname.c_str(), R_OK) != 0)
+		compile(source);
+	load();
+	alloc();
+#endif
+}
+
+/** The operation tree of a copy has the same indices, so all the
+ * tables are copied. */
+FormulaNativeEvaluator::FormulaNativeEvaluator(const FormulaParser& fp,
+											   const FormulaNativeEvaluator& fne)
+	: etree(fp.otree, -1), formulas(fp.formulas), maxorder(fne.maxorder),
+	  atoms(fne.atoms), atom_pos(fne.atom_pos), der_formula(fne.der_formula),
+	  der_vars(fne.der_vars), targets(fne.targets), natoms(fne.natoms),
+	  handle(NULL), libname(fne.libname), values(NULL), out(NULL)
+{
+	if (formulas != fne.formulas || fp.otree.get_num_op() != (int)atom_pos.size())
+		throw ogu::Exception(__FILE__,__LINE__,
+							 "Different formulas in FormulaNativeEvaluator copy constructor");
+	load();
+	alloc();
+}
+
+FormulaNativeEvaluator::~FormulaNativeEvaluator()
+{
+#if !defined(__MINGW32__)
+	if (handle)
+		dlclose(handle);
+#endif
+	if (values)
+		delete [] values;
+	if (out)
+		delete [] out;
+}
+
+void FormulaNativeEvaluator::alloc()
+{
+	unsigned int maxout = 1;
+	for (int ord = 0; ord <= maxorder; ord++)
+		if (targets[ord].size() > maxout)
+			maxout = targets[ord].size();
+	values = new double[natoms > 0 ? natoms : 1];
+	out = new double[maxout];
+}
+
+void FormulaNativeEvaluator::eval(const AtomValues& av, FormulaEvalLoader& loader)
+{
+	set_values(av, 0);
+	funcs[0](values, out);
+	for (unsigned int i = 0; i < formulas.size(); i++)
+		loader.load((int)i, out[i]);
+}
+
+void FormulaNativeEvaluator::eval(const AtomValues& av, FormulaDerEvalLoader& loader, int order)
+{
+	if (order > maxorder || order < 1) {
+		if (maxorder == 0)
+			return;
+		throw ogu::Exception(__FILE__,__LINE__,
+							 "Wrong order in FormulaNativeEvaluator::eval");
+	}
+
+	set_values(av, order);
+	funcs[order](values, out);
+	const vector<int>& form = der_formula[order];
+	if (form.size() > 0)
+		loader.load_all(order, (int)form.size(), &(form[0]), &(der_vars[order][0]), out);
+}
+
+void FormulaNativeEvaluator::set_values(const AtomValues& av, int order)
+{
+	etree.reset_all();
+	av.setValues(etree);
+	const vector<int>& ats = atoms[order];
+	for (unsigned int j = 0; j < ats.size(); j++)
+		values[atom_pos[ats[j]]] = etree.eval(ats[j]);
+}
+
+/** The terms needed by the targets are collected by a depth first
+ * search, the operands have always smaller indices than the
+ * operation, so the sorted operations are in the order of
+ * evaluation. */
+void FormulaNativeEvaluator::collect(int order, vector<int>& ops, vector<int>& ats) const
+{
+	const OperationTree& otree = etree.getOperationTree();
+	vector<bool> marked(otree.get_num_op(), false);
+	vector<int> stack(targets[order]);
+	while (! stack.empty()) {
+		int t = stack.back();
+		stack.pop_back();
+		if (marked[t] || t < OperationTree::num_constants)
+			continue;
+		marked[t] = true;
+		const Operation& op = otree.operation(t);
+		if (op.nary() == 0) {
+			ats.push_back(t);
+		} else {
+			ops.push_back(t);
+			stack.push_back(op.getOp1());
+			if (op.nary() == 2)
+				stack.push_back(op.getOp2());
+		}
+	}
+	std::sort(ops.begin(), ops.end());
+	std::sort(ats.begin(), ats.end());
+}
+
+void FormulaNativeEvaluator::format_term(int t, FILE* fd) const
+{
+	if (t == OperationTree::zero)
+		fprintf(fd, "0.0");
+	else if (t == OperationTree::one)
+		fprintf(fd, "1.0");
+	else if (t == OperationTree::nan)
+		fprintf(fd, "NAN");
+	else if (t == OperationTree::two_over_pi)
+		fprintf(fd, "%.17g", 2.0/sqrt(M_PI));
+	else if (atom_pos[t] >= 0)
+		fprintf(fd, "a[%d]", atom_pos[t]);
+	else
+		fprintf(fd, "t%d", t);
+}
+
+/** The shortcuts of EvalTree::eval() are written as conditional
+ * expressions, the operand tested for zero in a product is chosen
+ * in the same way. The function erffc() is the same as in
+ * tree.cpp. */
+void FormulaNativeEvaluator::write_source(FILE* fd) const
+{
+	const OperationTree& otree = etree.getOperationTree();
+	fprintf(fd,
+			"/* Generated by Dynare++, do not edit. */\n"
+			"#include <math.h>\n\n"
+			"static double erffc(double x)\n"
+			"{\n"
+			"\tdouble z = fabs(x);\n"
+			"\tdouble t = 1/(1+0.5*z);\n"
+			"\tdouble r = t*exp(-z*z-1.26551223+t*(1.00002368+t*(0.37409196+t*(0.09678418+t*(-0.18628806+t*(0.27886807+t*(-1.13520398+t*(1.48851587+t*(-0.82215223+t*0.17087277)))))))));\n"
+			"\treturn x >= 0 ? r : 2-r;\n"
+			"}\n");
+
+	for (int ord = 0; ord <= maxorder; ord++) {
+		vector<int> ops;
+		vector<int> ats;
+		collect(ord, ops, ats);
+		fprintf(fd, "\n/* %s of order %d */\n", ord == 0 ? "formulas" : "derivatives", ord);
+		fprintf(fd, "void dynpp_der%d(const double *a, double *out)\n{\n", ord);
+		for (unsigned int j = 0; j < ops.size(); j++) {
+			int t = ops[j];
+			const Operation& op = otree.operation(t);
+			int t1 = op.getOp1();
+			int t2 = op.getOp2();
+			fprintf(fd, "\tconst double t%d = ", t);
+			const char* fname = NULL;
+			switch (op.getCode()) {
+			case UMINUS:
+				fprintf(fd, "-");
+				format_term(t1, fd);
+				break;
+			case LOG:
+				fname = "log";
+				break;
+			case EXP:
+				fname = "exp";
+				break;
+			case SIN:
+				fname = "sin";
+				break;
+			case COS:
+				fname = "cos";
+				break;
+			case TAN:
+				fname = "tan";
+				break;
+			case SQRT:
+				fname = "sqrt";
+				break;
+			case ERF:
+				fprintf(fd, "1-erffc(");
+				format_term(t1, fd);
+				fprintf(fd, ")");
+				break;
+			case ERFC:
+				fname = "erffc";
+				break;
+			case PLUS:
+			case MINUS:
+				format_term(t1, fd);
+				fprintf(fd, op.getCode() == PLUS ? " + " : " - ");
+				format_term(t2, fd);
+				break;
+			case TIMES:
+				if (otree.nulary_of_term(t1).size() >= otree.nulary_of_term(t2).size())
+					std::swap(t1, t2);
+				format_term(t1, fd);
+				fprintf(fd, " == 0.0 ? 0.0 : ");
+				format_term(t1, fd);
+				fprintf(fd, "*");
+				format_term(t2, fd);
+				break;
+			case DIVIDE:
+				format_term(t1, fd);
+				fprintf(fd, " == 0.0 ? 0.0 : ");
+				format_term(t1, fd);
+				fprintf(fd, "/");
+				format_term(t2, fd);
+				break;
+			case POWER:
+				format_term(t2, fd);
+				fprintf(fd, " == 0.0 ? 1.0 : pow(");
+				format_term(t1, fd);
+				fprintf(fd, ", ");
+				format_term(t2, fd);
+				fprintf(fd, ")");
+				break;
+			default:
+				throw ogu::Exception(__FILE__,__LINE__,
+									 "Unknown operation code in FormulaNativeEvaluator::write_source");
+			}
+			if (fname) {
+				fprintf(fd, "%s(", fname);
+				format_term(t1, fd);
+				fprintf(fd, ")");
+			}
+			fprintf(fd, ";\n");
+		}
+		for (unsigned int j = 0; j < targets[ord].size(); j++) {
+			fprintf(fd, "\tout[%d] = ", j);
+			format_term(targets[ord][j], fd);
+			fprintf(fd, ";\n");
+		}
+		fprintf(fd, "}\n");
+	}
+}
+
+/** The source is kept next to the library. Both are first written
+ * to temporary names (suffixed by the process id) and then renamed,
+ * so that a concurrent process never compiles a partially written
+ * source nor loads a partially written library. The source is
+ * compiled from its temporary name, which is removed if anything
+ * fails. */
+void FormulaNativeEvaluator::compile(const string& source) const
+{
+#if !defined(__MINGW32__)
+	char pid[32];
+	sprintf(pid, ".%d", (int)getpid());
+	string base = libname.substr(0, libname.size()-3);
+	string srcname = base + ".c";
+	string tmpsrc = base + pid + ".c";
+	FILE* fd = fopen(tmpsrc.c_str(), "w");
+	if (fd == NULL)
+		throw ogu::Exception(__FILE__,__LINE__,
+							 string("Cannot open ") + tmpsrc + " for writing");
+	bool written = (fwrite(source.data(), 1, source.size(), fd) == source.size());
+	if (fclose(fd) != 0 || ! written) {
+		remove(tmpsrc.c_str());
+		throw ogu::Exception(__FILE__,__LINE__,
+							 string("Cannot write ") + tmpsrc);
+	}
+
+	string tmpname = libname + pid;
+	const char* cc = getenv("CC");
+	const char* cflags = getenv("DYNPP_CFLAGS");
+	string cmd = string(cc ? cc : "cc") + " " + (cflags ? cflags : "-O1")
+		+ " -shared -fPIC -o \"" + tmpname + "\" \"" + tmpsrc + "\" -lm";
+	if (system(cmd.c_str()) != 0) {
+		remove(tmpsrc.c_str());
+		remove(tmpname.c_str());
+		throw ogu::Exception(__FILE__,__LINE__,
+							 string("Compilation failed: ") + cmd);
+	}
+	if (rename(tmpsrc.c_str(), srcname.c_str()) != 0)
+		remove(tmpsrc.c_str());
+	if (rename(tmpname.c_str(), libname.c_str()) != 0) {
+		remove(tmpname.c_str());
+		throw ogu::Exception(__FILE__,__LINE__,
+							 string("Cannot rename ") + tmpname + " to " + libname);
+	}
+#endif
+}
+
+void FormulaNativeEvaluator::load()
+{
+#if !defined(__MINGW32__)
+	handle = dlopen(libname.c_str(), RTLD_NOW | RTLD_LOCAL);
+	if (handle == NULL)
+		throw ogu::Exception(__FILE__,__LINE__,
+							 string("Cannot load ") + libname + ": " + dlerror());
+	for (int ord = 0; ord <= maxorder; ord++) {
+		char fname[32];
+		sprintf(fname, "dynpp_der%d", ord);
+		Tevalfunc f = (Tevalfunc) dlsym(handle, fname);
+		if (f == NULL) {
+			dlclose(handle);
+			handle = NULL;
+			throw ogu::Exception(__FILE__,__LINE__,
+								 string("Cannot find ") + fname + " in " + libname);
+		}
+		funcs.push_back(f);
+	}
+#endif
+}
+
+/** This is 64-bit FNV-1a. */
+unsigned long long FormulaNativeEvaluator::hash(const string& s)
+{
+	unsigned long long h = 14695981039346656037ULL;
+	for (unsigned int i = 0; i < s.size(); i++) {
+		h ^= (unsigned char)s[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+// Local Variables:
+// mode:C++
+// End:
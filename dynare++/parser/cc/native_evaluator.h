@@ -0,0 +1,122 @@
+// Copyright (C) 2005-2011, Ondra Kamenik
+
+#ifndef OGP_NATIVE_EVALUATOR_H
+#define OGP_NATIVE_EVALUATOR_H
+
+#include "formula_parser.h"
+
+#include <string>
+
+namespace ogp
+{
+  using std::string;
+
+  /** This class evaluates the formulas of a FormulaParser and their
+   * derivatives by a native code. In the constructor, a C source
+   * evaluating the formulas (zero derivatives) and all derivatives of
+   * each order is written, compiled to a shared library and the
+   * library is loaded. The library is named after a hash of the
+   * source and is kept in the given cache directory, so the
+   * compilation is done only once for the same model; the parameter
+   * values do not enter the source, they are atoms.
+   *
+   * The values of atoms are obtained from AtomValues through an
+   * EvalTree as usual, so the object can be used in place of
+   * FormulaEvaluator and FormulaDerEvaluator with the same loaders.
+   * The generated code does the same shortcuts as EvalTree::eval(),
+   * the complementary error function is also the same. The compiler
+   * is given by the environment variable CC (default cc), the flags
+   * by DYNPP_CFLAGS (default -O1). If the code cannot be written,
+   * compiled or loaded, the constructor throws ogu::Exception. */
+  class FormulaNativeEvaluator
+  {
+  public:
+    /** Type of the generated functions. The first argument are
+     * the values of the atoms, the second the output. */
+    typedef void (*Tevalfunc)(const double *, double *);
+  protected:
+    /** Its own instance of EvalTree, used only for getting values
+     * of atoms. */
+    EvalTree etree;
+    /** The formulas. */
+    vector<int> formulas;
+    /** The maximum order of derivatives. */
+    int maxorder;
+    /** For each order, the tree indices of the atoms needed by
+     * the function of the order. */
+    vector<vector<int> > atoms;
+    /** The position of each atom (given by the tree index) in the
+     * array of the values, -1 for other terms. */
+    vector<int> atom_pos;
+    /** For each order (greater than zero), the formula of each
+     * evaluated derivative. */
+    vector<vector<int> > der_formula;
+    /** For each order (greater than zero), the tree indices of the
+     * atoms wrt which each derivative was taken, order indices per
+     * derivative. */
+    vector<vector<int> > der_vars;
+    /** For each order, the tree indices of the evaluated terms. */
+    vector<vector<int> > targets;
+    /** Total number of atoms in the array of the values. */
+    int natoms;
+    /** The functions, one per order. */
+    vector<Tevalfunc> funcs;
+    /** The handle of the loaded library. */
+    void *handle;
+    /** The name of the library. */
+    string libname;
+    /** Array of values of atoms. */
+    double *values;
+    /** Array of outputs. */
+    double *out;
+  public:
+    /** Write, compile (if not in the cache) and load the code for
+     * the given FormulaParser. It must be differentiated
+     * already. */
+    FormulaNativeEvaluator(const FormulaParser &fp, const char *cache_dir);
+    /** Make an evaluator of a copy of the FormulaParser of the
+     * given evaluator. The source is not written again, the loaded
+     * library is shared (its reference count is increased). */
+    FormulaNativeEvaluator(const FormulaParser &fp, const FormulaNativeEvaluator &fne);
+    virtual ~FormulaNativeEvaluator();
+    /** Evaluate the formulas as FormulaEvaluator::eval(). */
+    void eval(const AtomValues &av, FormulaEvalLoader &loader);
+    /** Evaluate the derivatives of the given order as
+     * FormulaDerEvaluator::eval(). */
+    void eval(const AtomValues &av, FormulaDerEvalLoader &loader, int order);
+    /** Return the name of the loaded library. */
+    const char *
+    get_library() const
+    {
+      return libname.c_str();
+    }
+    /** Write the C source to the given file. */
+    void write_source(FILE *fd) const;
+  protected:
+    /** Set the values of the atoms needed for the order. */
+    void set_values(const AtomValues &av, int order);
+    /** Allocate the arrays of values and outputs. */
+    void alloc();
+    /** Compile the source to the library. */
+    void compile(const string &source) const;
+    /** Load the library and its functions. */
+    void load();
+    /** Collect the operations (sorted, so that operands go first)
+     * and the atoms needed for the targets of the order. */
+    void collect(int order, vector<int> &ops, vector<int> &ats) const;
+    /** This prints a string representation of the term, a
+     * literal for hardwired constants, an element of the values
+     * for atoms and a local variable for operations. */
+    void format_term(int t, FILE *fd) const;
+    /** Return a hash of the string. */
+    static unsigned long long hash(const string &s);
+  private:
+    FormulaNativeEvaluator(const FormulaNativeEvaluator &);
+  };
+};
+
+#endif
+
+// Local Variables:
+// mode:C++
+// End:
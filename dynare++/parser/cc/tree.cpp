@@ -41,6 +41,8 @@ double erffc(double x)
 OperationTree::OperationTree()
 {
 	last_nulary = -1;
+	patch_base = -1;
+	patch_pool = -1;
 	// allocate space for the constants
 	for (int i = 0; i < num_constants; i++)
 		add_nulary();
@@ -51,8 +53,8 @@ int OperationTree::add_nulary()
 	int op = terms.size();
 	Operation nulary;
 	terms.push_back(nulary);
-	_Tintset s;
-	s.insert(op);
+	_Tspan s = {(int)nul_pool.size(), 1};
+	nul_pool.push_back(op);
 	nul_incidence.push_back(s);
 	_Tderivmap empty;
 	derivatives.push_back(empty);
@@ -82,7 +84,7 @@ int OperationTree::add_unary(code_t code, int op)
 		int newop = terms.size();
 		// add to the terms
 		terms.push_back(unary);
-		// copy incidence of the operand
+		// share incidence of the operand
 		nul_incidence.push_back(nul_incidence[op]);
 		// insert it to opmap
 		opmap.insert(_Topval(unary, newop));
@@ -164,8 +166,7 @@ int OperationTree::add_binary(code_t code, int op1, int op2)
 		int newop = terms.size();
 		terms.push_back(binary);
 		// sum both sets of incidenting nulary operations
-		nul_incidence.push_back(nul_incidence[op1]);
-		nul_incidence.back().insert(nul_incidence[op2].begin(), nul_incidence[op2].end());
+		nul_incidence.push_back(merge_incidence(nul_incidence[op1], nul_incidence[op2]));
 		// add to opmap
 		opmap.insert(_Topval(binary, newop));
 		// add empty map of derivatives
@@ -189,14 +190,14 @@ int OperationTree::add_derivative(int t, int v)
 	if (terms[t].nary() == 0 && t == v) {
 		return one;
 	}
-	if (nul_incidence[t].end() == nul_incidence[t].find(v)) {
+	if (! nulary_of_term(t).contains(v)) {
 		return zero;
 	}
 
 	// quick return if the derivative has been registered
-	_Tderivmap::const_iterator i = derivatives[t].find(v);
-	if (i != derivatives[t].end())
-		return (*i).second;
+	int reg = find_derivative(t, v);
+	if (reg >= 0)
+		return reg;
 
 	int res = -1;
 	switch (terms[t].getCode()) {
@@ -389,8 +390,147 @@ void OperationTree::nularify(int t)
 
 void OperationTree::register_derivative(int t, int v, int tder)
 {
-	// todo: might check that the insert inserts a new pair
-	derivatives[t].insert(_Tderivmap::value_type(v, tder));
+	_Tderivmap& dm = derivatives[t];
+	_Tderivmap::iterator it = std::lower_bound(dm.begin(), dm.end(),
+											   std::pair<int, int>(v, -1));
+	if (it != dm.end() && (*it).first == v)
+		return;
+	dm.insert(it, std::pair<int, int>(v, tder));
+	if (patch_base >= 0) {
+		TreePatch::Tderiv d = {t, v, tder};
+		patch_ders.push_back(d);
+	}
+}
+
+int OperationTree::find_derivative(int t, int v) const
+{
+	const _Tderivmap& dm = derivatives[t];
+	_Tderivmap::const_iterator it = std::lower_bound(dm.begin(), dm.end(),
+													 std::pair<int, int>(v, -1));
+	if (it != dm.end() && (*it).first == v)
+		return (*it).second;
+	return -1;
+}
+
+/** The union is merged at the end of the pool. The pool is accessed
+ * by indices since it may be reallocated during the merge. If the
+ * union has the length of one of the spans, it is equal to it and
+ * the merged copy is dropped. */
+OperationTree::_Tspan OperationTree::merge_incidence(const _Tspan& s1, const _Tspan& s2)
+{
+	int start = nul_pool.size();
+	int i1 = s1.off;
+	int i2 = s2.off;
+	const int end1 = s1.off + s1.len;
+	const int end2 = s2.off + s2.len;
+	while (i1 < end1 && i2 < end2) {
+		int n1 = nul_pool[i1];
+		int n2 = nul_pool[i2];
+		if (n1 < n2) {
+			nul_pool.push_back(n1);
+			i1++;
+		} else if (n2 < n1) {
+			nul_pool.push_back(n2);
+			i2++;
+		} else {
+			nul_pool.push_back(n1);
+			i1++;
+			i2++;
+		}
+	}
+	for (; i1 < end1; i1++) {
+		int n1 = nul_pool[i1];
+		nul_pool.push_back(n1);
+	}
+	for (; i2 < end2; i2++) {
+		int n2 = nul_pool[i2];
+		nul_pool.push_back(n2);
+	}
+
+	int len = (int)nul_pool.size() - start;
+	if (len == s1.len || len == s2.len) {
+		nul_pool.resize(start);
+		return (len == s1.len) ? s1 : s2;
+	}
+	_Tspan res = {start, len};
+	return res;
+}
+
+void OperationTree::start_patch()
+{
+	if (patch_base >= 0)
+		throw ogu::Exception(__FILE__,__LINE__,
+							 "Patch already started in OperationTree::start_patch");
+	patch_base = terms.size();
+	patch_pool = nul_pool.size();
+	patch_ders.clear();
+}
+
+void OperationTree::end_patch(TreePatch& p)
+{
+	if (patch_base < 0)
+		throw ogu::Exception(__FILE__,__LINE__,
+							 "Patch not started in OperationTree::end_patch");
+	p.base = patch_base;
+	p.terms.assign(terms.begin()+patch_base, terms.end());
+	p.ders.swap(patch_ders);
+	patch_ders.clear();
+
+	// return to the state before start_patch()
+	for (int t = patch_base; t < (int)terms.size(); t++) {
+		if (terms[t].nary() == 0)
+			throw ogu::Exception(__FILE__,__LINE__,
+								 "Nulary term in a patch in OperationTree::end_patch");
+		opmap.erase(terms[t]);
+	}
+	terms.resize(patch_base);
+	nul_incidence.resize(patch_base);
+	nul_pool.resize(patch_pool);
+	derivatives.resize(patch_base);
+	for (unsigned int i = 0; i < p.ders.size(); i++)
+		if (p.ders[i].t < patch_base) {
+			_Tderivmap& dm = derivatives[p.ders[i].t];
+			_Tderivmap::iterator it = std::lower_bound(dm.begin(), dm.end(),
+													   std::pair<int, int>(p.ders[i].v, -1));
+			if (it != dm.end() && (*it).first == p.ders[i].v)
+				dm.erase(it);
+		}
+	patch_base = -1;
+	patch_pool = -1;
+}
+
+void OperationTree::apply_patch(const TreePatch& p, vector<int>& map)
+{
+	if (p.base < 0 || p.base > (int)terms.size())
+		throw ogu::Exception(__FILE__,__LINE__,
+							 "Wrong base of the patch in OperationTree::apply_patch");
+
+	map.resize(p.terms.size());
+	for (unsigned int i = 0; i < p.terms.size(); i++) {
+		const Operation& op = p.terms[i];
+		int t1 = op.getOp1();
+		if (t1 >= p.base)
+			t1 = map[t1-p.base];
+		if (op.nary() == 1)
+			map[i] = add_unary(op.getCode(), t1);
+		else {
+			int t2 = op.getOp2();
+			if (t2 >= p.base)
+				t2 = map[t2-p.base];
+			map[i] = add_binary(op.getCode(), t1, t2);
+		}
+	}
+
+	for (unsigned int i = 0; i < p.ders.size(); i++) {
+		int t = p.ders[i].t;
+		if (t >= p.base)
+			t = map[t-p.base];
+		int der = p.ders[i].der;
+		if (der >= p.base)
+			der = map[der-p.base];
+		if (find_derivative(t, p.ders[i].v) < 0)
+			register_derivative(t, p.ders[i].v, der);
+	}
 }
 
 unordered_set<int> OperationTree::select_terms(int t, const opselector& sel) const
@@ -481,8 +621,7 @@ void OperationTree::update_nul_incidence_after_nularify(int t)
 			bool updated1 = (updated.end() != updated.find(op1));
 			bool updated2 = (updated.end() != updated.find(op2));
 			if (updated1 || updated2) {
-				nul_incidence[tnode] = nul_incidence[op1];
-				nul_incidence[tnode].insert(nul_incidence[op2].begin(), nul_incidence[op2].end());
+				nul_incidence[tnode] = merge_incidence(nul_incidence[op1], nul_incidence[op2]);
 				updated.insert(tnode);
 			}
 		} else if (op.nary() == 1) {
@@ -497,8 +636,9 @@ void OperationTree::update_nul_incidence_after_nularify(int t)
 			}
 		} else if (op.nary() == 0) {
 			if (tnode == t) {
-				nul_incidence[tnode].clear();
-				nul_incidence[tnode].insert(tnode);
+				nul_incidence[tnode].off = nul_pool.size();
+				nul_incidence[tnode].len = 1;
+				nul_pool.push_back(tnode);
 				updated.insert(tnode);
 			}
 		}
@@ -672,6 +812,191 @@ void EvalTree::print() const
 	}
 }
 
+EvalTape::EvalTape(const OperationTree& otree, const vector<int>& ts, int last)
+	: terms(ts)
+{
+	int nterms = (last == -1)? (int)otree.terms.size() : last+1;
+	if (nterms > (int)otree.terms.size())
+		throw ogu::Exception(__FILE__,__LINE__,
+							 "Wrong last in EvalTape constructor.");
+
+	vector<bool> marked(nterms, false);
+	seg_start.push_back(0);
+	for (unsigned int i = 0; i < terms.size(); i++) {
+		if (terms[i] < 0 || terms[i] >= nterms)
+			throw ogu::Exception(__FILE__,__LINE__,
+								 "The tree index out of bounds in EvalTape constructor");
+		// emit the terms needed by terms[i] and not marked yet
+		emit(otree, terms[i], marked);
+		seg_start.push_back((int)instrs.size());
+	}
+}
+
+/** The terms are emitted in the order in which EvalTree::eval()
+ * visits them, so operands always go before the operation. The
+ * operand of TIMES, DIVIDE and POWER tested for zero goes first,
+ * then a test instruction, and then the instructions of the other
+ * operand, which are skipped if the tested value is zero. */
+void EvalTape::emit(const OperationTree& otree, int t, vector<bool>& marked)
+{
+	if (marked[t] || t < OperationTree::num_constants)
+		return;
+	const Operation& op = otree.terms[t];
+	if (op.nary() == 0)
+		return;
+	marked[t] = true;
+
+	Instruction ins;
+	ins.code = op.getCode();
+	ins.res = t;
+	ins.op1 = op.getOp1();
+	ins.op2 = op.getOp2();
+	ins.skip = 0;
+	// the operand tested for zero goes first, as in EvalTree::eval
+	if (ins.code == TIMES
+		&& otree.nulary_of_term(ins.op1).size() >= otree.nulary_of_term(ins.op2).size()) {
+		ins.op1 = op.getOp2();
+		ins.op2 = op.getOp1();
+	}
+
+	if (ins.code == TIMES || ins.code == DIVIDE || ins.code == POWER) {
+		int tested = (ins.code == POWER)? ins.op2 : ins.op1;
+		int other = (ins.code == POWER)? ins.op1 : ins.op2;
+		emit(otree, tested, marked);
+		int k = (int)instrs.size();
+		Instruction test;
+		test.code = NONE;
+		test.res = -1;
+		test.op1 = tested;
+		test.op2 = -1;
+		test.skip = 0;
+		instrs.push_back(test);
+		emit(otree, other, marked);
+		instrs[k].skip = (int)instrs.size() - k - 1;
+		if (instrs[k].skip == 0)
+			instrs.pop_back();
+	} else {
+		emit(otree, ins.op1, marked);
+		if (op.nary() == 2)
+			emit(otree, ins.op2, marked);
+	}
+	instrs.push_back(ins);
+}
+
+void EvalTape::eval(EvalTree& et) const
+{
+	for (unsigned int i = 0; i < terms.size(); i++)
+		eval_segment(et, i);
+}
+
+double EvalTape::eval(EvalTree& et, int i) const
+{
+	eval_segment(et, i);
+	return et.eval(terms[i]);
+}
+
+/** The values are read directly from the EvalTree, only terms which
+ * have not been evaluated by the tape go through EvalTree::eval(). */
+void EvalTape::eval(EvalTree& et, double* res) const
+{
+	eval(et);
+	for (unsigned int i = 0; i < terms.size(); i++)
+		res[i] = et.flags[terms[i]] ? et.values[terms[i]] : et.eval(terms[i]);
+}
+
+/** The instruction is skipped if its result has been already
+ * evaluated or if some of its needed operands has not been
+ * evaluated. The latter happens if a nulary term has not been set,
+ * or if the operand was left out by a zero shortcut, then the final
+ * call to EvalTree::eval() does the right thing. The shortcuts are
+ * the same as in EvalTree::eval(), and the operand not needed
+ * because of a shortcut is not evaluated at all, so that it can be
+ * evaluated later with different nulary terms. */
+void EvalTape::eval_segment(EvalTree& et, int i) const
+{
+	if (terms[i] > et.last_operation)
+		throw ogu::Exception(__FILE__,__LINE__,
+							 "EvalTree too short in EvalTape::eval");
+
+	double* const values = et.values;
+	bool* const flags = et.flags;
+	for (int k = seg_start[i]; k < seg_start[i+1]; k++) {
+		const Instruction& ins = instrs[k];
+		if (ins.code == NONE) {
+			// skip the other operand if the tested one is zero or unknown
+			if (! flags[ins.op1] || values[ins.op1] == 0.0)
+				k += ins.skip;
+			continue;
+		}
+		if (flags[ins.res])
+			continue;
+		if ((ins.code == TIMES || ins.code == DIVIDE)
+			&& flags[ins.op1] && values[ins.op1] == 0.0) {
+			values[ins.res] = 0.0;
+			flags[ins.res] = true;
+			continue;
+		}
+		if (ins.code == POWER && flags[ins.op2] && values[ins.op2] == 0.0) {
+			values[ins.res] = 1.0;
+			flags[ins.res] = true;
+			continue;
+		}
+		if (! flags[ins.op1] || (ins.op2 >= 0 && ! flags[ins.op2]))
+			continue;
+		double r1 = values[ins.op1];
+		double res;
+		switch (ins.code) {
+		case UMINUS:
+			res = -r1;
+			break;
+		case LOG:
+			res = log(r1);
+			break;
+		case EXP:
+			res = exp(r1);
+			break;
+		case SIN:
+			res = sin(r1);
+			break;
+		case COS:
+			res = cos(r1);
+			break;
+		case TAN:
+			res = tan(r1);
+			break;
+		case SQRT:
+			res = sqrt(r1);
+			break;
+		case ERF:
+			res = 1-erffc(r1);
+			break;
+		case ERFC:
+			res = erffc(r1);
+			break;
+		case PLUS:
+			res = r1 + values[ins.op2];
+			break;
+		case MINUS:
+			res = r1 - values[ins.op2];
+			break;
+		case TIMES:
+			res = r1 * values[ins.op2];
+			break;
+		case DIVIDE:
+			res = r1 / values[ins.op2];
+			break;
+		case POWER:
+			res = pow(r1, values[ins.op2]);
+			break;
+		default:
+			throw ogu::Exception(__FILE__,__LINE__,
+								 "Unknown operation code in EvalTape::eval");
+		}
+		values[ins.res] = res;
+		flags[ins.res] = true;
+	}
+}
+
 void DefaultOperationFormatter::format(const Operation& op, int t, FILE* fd)
 {
 	// add to the stop_set
@@ -5,6 +5,7 @@
 
 #include <vector>
 #include <set>
+#include <algorithm>
 #include <map>
 #include <boost/unordered_map.hpp>
 #include <boost/unordered_set.hpp>
@@ -93,7 +94,10 @@ namespace ogp
     size_t
     hashval() const
     {
-      return op2+1 + (op1+1)^15 + code^30;
+      size_t h = code;
+      h = h*1000003 ^ (size_t) (op1+1);
+      h = h*1000003 ^ (size_t) (op2+1);
+      return h;
     }
 
     code_t
@@ -145,12 +149,77 @@ namespace ogp
     }
   };
 
+  /** This is a sorted list of the nulary terms of a term in an
+   * OperationTree. It does not own the data, it is a view of a part
+   * of a pool shared by all terms of the tree, so it is cheap to
+   * copy. The elements are accessed by indices to the pool, so the
+   * view remains valid when new terms are added to the tree. */
+  class NularySpan
+  {
+  protected:
+    const vector<int> *pool;
+    int off;
+    int len;
+  public:
+    NularySpan(const vector<int> &p, int o, int l)
+      : pool(&p), off(o), len(l)
+    {
+    }
+    /** Return the number of the nulary terms. */
+    int
+    size() const
+    {
+      return len;
+    }
+    /** Return the i-th nulary term in the increasing order. */
+    int
+    operator[](int i) const
+    {
+      return (*pool)[off+i];
+    }
+    /** Return true if the given nulary term is in the list. */
+    bool
+    contains(int t) const
+    {
+      return std::binary_search(pool->begin()+off, pool->begin()+off+len, t);
+    }
+  };
+
   /** Forward declaration of OperationFormatter. */
   class OperationFormatter;
   class DefaultOperationFormatter;
 
   /** Forward declaration of EvalTree to make it friend of OperationTree. */
   class EvalTree;
+  class EvalTape;
+
+  /** TreePatch holds the terms added to an OperationTree after a
+   * given base index and the derivatives registered meanwhile. It
+   * is created by OperationTree::end_patch() in one tree and can be
+   * applied by OperationTree::apply_patch() to another tree which
+   * has the same terms up to the base. This is used to differentiate
+   * the formulas in local copies of the tree in parallel and to merge
+   * the results to the original tree. */
+  struct TreePatch
+  {
+    /** A registered derivative. */
+    struct Tderiv
+    {
+      int t;
+      int v;
+      int der;
+    };
+    /** The number of the terms the patch is based on. */
+    int base;
+    /** The new terms, i-th has the tree index base+i. */
+    vector<Operation> terms;
+    /** The derivatives registered after the base. */
+    vector<Tderiv> ders;
+    TreePatch()
+      : base(-1)
+    {
+    }
+  };
 
   /** Class representing a set of trees for terms. Each term is
    * given a unique non-negative integer. The terms are basically
@@ -169,18 +238,24 @@ namespace ogp
    * recognize zero derivativates, we maintain a list of nulary
    * terms contained in the term. A possible zero derivative is then quickly
    * recognized by looking at the list. The list is implemented as a
-   * unordered_set of integers.
+   * sorted span of integers in a pool shared by all terms. A unary
+   * term shares the span of its operand, a binary term shares the
+   * span of an operand if the other operand has no other nulary
+   * terms, so the pool is much smaller than a set per term.
    *
    * In addition, many term can be differentiated multiple times wrt
    * one variable since they can be referenced multiple times. To
    * avoid this, for each term we maintain a map mapping variables
    * to the derivatives of the term. As the caller will
    * differentiate wrt more and more variables, these maps will
-   * become richer and richer.
+   * become richer and richer. The map is a vector of pairs sorted
+   * by the variables, which does not allocate anything for terms
+   * which are not differentiated.
    */
   class OperationTree
   {
     friend class EvalTree;
+    friend class EvalTape;
     friend class DefaultOperationFormatter;
   protected:
     /** This is the vector of the terms. An index to this vector
@@ -196,15 +271,21 @@ namespace ogp
      * the indices of the terms.*/
     _Topmap opmap;
 
-    /** This is a type for a set of integers. */
-    typedef unordered_set<int> _Tintset;
-    /** This is a vector of integer sets corresponding to the
+    /** This is a type for a span of the pool of nulary terms. */
+    struct _Tspan
+    {
+      int off;
+      int len;
+    };
+    /** This is the pool of the sorted lists of nulary terms. */
+    vector<int> nul_pool;
+    /** This is a vector of spans of nul_pool corresponding to the
      * nulary terms contained in the term. */
-    vector<_Tintset> nul_incidence;
+    vector<_Tspan> nul_incidence;
 
     /** This is a type of the map from variables (nulary terms) to
-     * the terms. */
-    typedef unordered_map<int, int> _Tderivmap;
+     * the terms, sorted by the variables. */
+    typedef vector<std::pair<int, int> > _Tderivmap;
     /** This is a vector of derivative mappings. For each term, it
      * maps variables to the derivatives of the term with respect
      * to the variables. */
@@ -212,6 +293,15 @@ namespace ogp
 
     /** The tree index of the last nulary term. */
     int last_nulary;
+
+    /** The base of the patch being recorded, -1 if no patch is
+     * recorded. */
+    int patch_base;
+    /** The size of nul_pool at the start of the patch. */
+    int patch_pool;
+    /** The derivatives registered since the start of the
+     * patch. */
+    vector<TreePatch::Tderiv> patch_ders;
   public:
     /** This is a number of constants set in the following
      * enum. This number reserves space in a vector of terms for
@@ -229,9 +319,9 @@ namespace ogp
 
     /** Copy constructor. */
     OperationTree(const OperationTree &ot)
-      : terms(ot.terms), opmap(ot.opmap), nul_incidence(ot.nul_incidence),
-        derivatives(ot.derivatives),
-        last_nulary(ot.last_nulary)
+      : terms(ot.terms), opmap(ot.opmap), nul_pool(ot.nul_pool),
+        nul_incidence(ot.nul_incidence), derivatives(ot.derivatives),
+        last_nulary(ot.last_nulary), patch_base(-1), patch_pool(-1)
     {
     }
 
@@ -292,11 +382,11 @@ namespace ogp
      * forgotten with forget_derivative_maps. */
     void nularify(int t);
 
-    /** Return the set of nulary terms of the given term. */
-    const unordered_set<int> &
+    /** Return the sorted list of nulary terms of the given term. */
+    NularySpan
     nulary_of_term(int t) const
     {
-      return nul_incidence[t];
+      return NularySpan(nul_pool, nul_incidence[t].off, nul_incidence[t].len);
     }
 
     /** Select subterms of the given term according a given
@@ -324,6 +414,23 @@ namespace ogp
      * additional nodes (trees). */
     void forget_derivative_maps();
 
+    /** Start recording a patch. All terms added and derivatives
+     * registered from now on will be in the patch. */
+    void start_patch();
+
+    /** Finish recording the patch, move the new terms and the
+     * registered derivatives to the given patch and return the
+     * tree to the state before start_patch(). */
+    void end_patch(TreePatch &p);
+
+    /** Apply the patch recorded in another tree. The terms up to
+     * the base of the patch must be the same in both trees. The
+     * new terms are added in the order of the patch (existing
+     * ones are not duplicated) and the derivatives are registered.
+     * On return, map[i] is the tree index here of the term
+     * p.base+i of the patch. */
+    void apply_patch(const TreePatch &p, vector<int> &map);
+
     /** This returns an operation of a given term. */
     const Operation &
     operation(int t) const
@@ -360,6 +467,13 @@ namespace ogp
      * @param tder the index of the resulting derivative
      */
     void register_derivative(int t, int v, int tder);
+    /** Return the registered derivative of the term t wrt v, or -1
+     * if it has not been registered. */
+    int find_derivative(int t, int v) const;
+    /** Return the span of the union of the two spans. The span of
+     * an operand is returned if it contains the other one,
+     * otherwise the union is added at the end of the pool. */
+    _Tspan merge_incidence(const _Tspan &s1, const _Tspan &s2);
     /** This does the same job as select_terms with the only
      * difference, that it adds the terms to the given set and
      * hence can be used recursivelly. */
@@ -396,6 +510,7 @@ namespace ogp
    */
   class EvalTree
   {
+    friend class EvalTape;
   protected:
     /** Reference to the OperationTree over which all evaluations
      * are done. */
@@ -436,6 +551,86 @@ namespace ogp
     EvalTree(const EvalTree &);
   };
 
+  /** EvalTape is a linearized form of the evaluation of a given
+   * list of terms. The terms needed for the evaluation are
+   * collected once in the order in which EvalTree::eval() visits
+   * them (operands always go before the operation), and stored as
+   * a flat sequence of instructions. The evaluation is then one
+   * forward sweep over the instructions writing the values to an
+   * EvalTree, without the recursion and without the per call
+   * checks of EvalTree::eval().
+   *
+   * The instructions are split into segments, the i-th segment
+   * contains the terms needed by the i-th term of the list and not
+   * needed by any of the previous terms. This allows the caller to
+   * change the nulary terms between the evaluations of the terms
+   * (as AtomAsgnEvaluator does) with the same effect as the lazy
+   * evaluation of EvalTree. For the same reason, the operand which
+   * EvalTree::eval() does not evaluate because of a zero shortcut
+   * (in a product, a quotient or a power) is skipped by a test
+   * instruction preceding its instructions.
+   *
+   * An instruction is performed only if its operands have been
+   * evaluated. If some nulary term has not been set, or an operand
+   * has been skipped, the dependent instructions are skipped, and
+   * EvalTree::eval() called on the resulting term evaluates the rest
+   * or raises the exception as usual. The tape does not hold any
+   * values, it can be shared by more EvalTree objects over the same
+   * OperationTree. */
+  class EvalTape
+  {
+  protected:
+    /** One instruction of the tape. If the code is NONE, this is
+     * a test instruction, the following skip instructions are
+     * skipped if op1 is zero or not evaluated. */
+    struct Instruction
+    {
+      code_t code;
+      int res;
+      int op1;
+      int op2;
+      int skip;
+    };
+    /** The instructions. */
+    vector<Instruction> instrs;
+    /** The instructions of i-th segment are from seg_start[i]
+     * (included) to seg_start[i+1] (excluded). */
+    vector<int> seg_start;
+    /** The terms to be evaluated. */
+    vector<int> terms;
+  public:
+    /** Build the tape for the given list of terms of the
+     * operation tree. If last is greater than -1, all the terms
+     * must be less or equal to it, it should be the last operation
+     * of the EvalTree used for evaluation. */
+    EvalTape(const OperationTree &otree, const vector<int> &ts, int last = -1);
+    /** Evaluate all the terms into the given EvalTree. The nulary
+     * terms must be set before. Values of the terms are then
+     * retrieved by EvalTree::eval(). */
+    void eval(EvalTree &et) const;
+    /** Evaluate the i-th segment and return a value of the i-th
+     * term. */
+    double eval(EvalTree &et, int i) const;
+    /** Evaluate all the terms into the given EvalTree and store
+     * the value of the i-th term to res[i]. */
+    void eval(EvalTree &et, double *res) const;
+    /** Return the number of the terms. */
+    int
+    nterms() const
+    {
+      return (int) terms.size();
+    }
+    /** Return the number of instructions. */
+    int
+    length() const
+    {
+      return (int) instrs.size();
+    }
+  protected:
+    void emit(const OperationTree &otree, int t, vector<bool> &marked);
+    void eval_segment(EvalTree &et, int i) const;
+  };
+
   /** This is an interface describing how a given operation is
    * formatted for output. */
   class OperationFormatter
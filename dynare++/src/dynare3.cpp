@@ -41,7 +41,7 @@ vector<int> DynareNameList::selectIndices(const vector<const char*>& ns) const
 
 Dynare::Dynare(const char* modname, int ord, double sstol, Journal& jr)
 	: journal(jr), model(NULL), ysteady(NULL), md(1), dnl(NULL), denl(NULL), dsnl(NULL),
-	  fe(NULL), fde(NULL), ss_tol(sstol)
+	  fe(NULL), fde(NULL), fne(NULL), ss_tol(sstol)
 {
 	// make memory file
 	ogu::MemoryFile mf(modname);
@@ -72,7 +72,7 @@ Dynare::Dynare(const char** endo, int num_endo,
 			   const char* equations, int len, int ord,
 			   double sstol, Journal& jr)
 	: journal(jr), model(NULL), ysteady(NULL), md(1), dnl(NULL), denl(NULL), dsnl(NULL),
-	  fe(NULL), fde(NULL), ss_tol(sstol)
+	  fe(NULL), fde(NULL), fne(NULL), ss_tol(sstol)
 {
 	try {
 		model = new ogdyn::DynareSPModel(endo, num_endo, exo, num_exo, par, num_par,
@@ -92,7 +92,7 @@ Dynare::Dynare(const char** endo, int num_endo,
 Dynare::Dynare(const Dynare& dynare)
 	: journal(dynare.journal), model(NULL),
 	  ysteady(NULL), md(dynare.md),
-	  dnl(NULL), denl(NULL), dsnl(NULL), fe(NULL), fde(NULL),
+	  dnl(NULL), denl(NULL), dsnl(NULL), fe(NULL), fde(NULL), fne(NULL),
 	  ss_tol(dynare.ss_tol)
 {
 	model = dynare.model->clone();
@@ -102,6 +102,17 @@ Dynare::Dynare(const Dynare& dynare)
 	dsnl = new DynareStateNameList(*this, *dnl, *denl);
 	fe = new ogp::FormulaEvaluator(model->getParser());
 	fde = new ogp::FormulaDerEvaluator(model->getParser());
+	if (dynare.fne) {
+		// share the loaded library, keep the interpreted evaluation
+		// if this fails
+		native_dir = dynare.native_dir;
+		try {
+			fne = new ogp::FormulaNativeEvaluator(model->getParser(), *(dynare.fne));
+		} catch (const ogu::Exception& e) {
+			JournalRecord rec(journal);
+			rec << "Native code not used in a copy: " << e.message() << endrec;
+		}
+	}
 }
 
 Dynare::~Dynare()
@@ -120,6 +131,8 @@ Dynare::~Dynare()
 		delete fe;
 	if (fde)
 		delete fde;
+	if (fne)
+		delete fne;
 }
 
 void Dynare::writeMat(mat_t* fd, const char* prefix) const
@@ -165,10 +178,18 @@ void Dynare::solveDeterministicSteady(Vector& steady)
 	pa << "Non-linear solver for deterministic steady state" << endrec;
 	steady = (const Vector&) model->getInit();
 	DynareVectorFunction dvf(*this);
-	DynareJacobian dj(*this);
-	ogu::NLSolver nls(dvf, dj, 500, ss_tol, journal);
 	int iter;
-	if (! nls.solve(steady, iter))
+	bool converged;
+	if (ny() >= sparse_steady_dim) {
+		DynareSparseJacobian dj(*this);
+		ogu::NLSolver nls(dvf, dj, 500, ss_tol, journal);
+		converged = nls.solve(steady, iter);
+	} else {
+		DynareJacobian dj(*this);
+		ogu::NLSolver nls(dvf, dj, 500, ss_tol, journal);
+		converged = nls.solve(steady, iter);
+	}
+	if (! converged)
 		throw DynareException(__FILE__, __LINE__,
 							  "Could not obtain convergence in non-linear solver");
 }
@@ -189,7 +210,10 @@ void Dynare::evaluateSystem(Vector& out, const Vector& yym, const Vector& yy,
 {
 	ogdyn::DynareAtomValues dav(model->getAtoms(), model->getParams(), yym, yy, yyp, xx);
 	DynareEvalLoader del(model->getAtoms(), out);
-	fe->eval(dav, del);
+	if (fne)
+		fne->eval(dav, del);
+	else
+		fe->eval(dav, del);
 }
 
 void Dynare::calcDerivatives(const Vector& yy, const Vector& xx)
@@ -199,7 +223,10 @@ void Dynare::calcDerivatives(const Vector& yy, const Vector& xx)
 	ogdyn::DynareAtomValues dav(model->getAtoms(), model->getParams(), yym, yy, yyp, xx);
 	DynareDerEvalLoader ddel(model->getAtoms(), md, model->getOrder());
 	for (int iord = 1; iord <= model->getOrder(); iord++)
-		fde->eval(dav, ddel, iord);
+		if (fne)
+			fne->eval(dav, ddel, iord);
+		else
+			fde->eval(dav, ddel, iord);
 }
 
 void Dynare::calcDerivativesAtSteady()
@@ -209,6 +236,25 @@ void Dynare::calcDerivativesAtSteady()
 	calcDerivatives(*ysteady, xx);
 }
 
+void Dynare::useNativeCode(const char* cache_dir)
+{
+	if (fne) {
+		delete fne;
+		fne = NULL;
+	}
+	native_dir = cache_dir;
+	JournalRecordPair pa(journal);
+	pa << "Native code for the model in " << cache_dir << endrec;
+	try {
+		fne = new ogp::FormulaNativeEvaluator(model->getParser(), cache_dir);
+		JournalRecord rec(journal);
+		rec << "Loaded " << fne->get_library() << endrec;
+	} catch (const ogu::Exception& e) {
+		JournalRecord rec(journal);
+		rec << "Native code not used: " << e.message() << endrec;
+	}
+}
+
 void Dynare::writeModelInfo(Journal& jr) const
 {
 	// write info on variables
@@ -324,6 +370,20 @@ void DynareDerEvalLoader::load(int i, int iord, const int* vars, double res)
 	t->insert(s, i, res);
 }
 
+/** The tensor and the key are obtained only once for all the
+ * results. */
+void DynareDerEvalLoader::load_all(int iord, int n, const int* formulas, const int* vars,
+								   const double* res)
+{
+	FSSparseTensor* t = md.get(Symmetry(iord));
+	IntSequence s(iord, 0);
+	for (int k = 0; k < n; k++) {
+		for (int j = 0; j < iord; j++)
+			s[j] = atoms.get_pos_of_all(vars[k*iord+j]);
+		t->insert(s, formulas[k], res[k]);
+	}
+}
+
 DynareJacobian::DynareJacobian(Dynare& dyn)
 	: Jacobian(dyn.ny()), d(dyn)
 {
@@ -335,7 +395,10 @@ void DynareJacobian::eval(const Vector& yy)
 	ogdyn::DynareSteadyAtomValues
 		dav(d.getModel().getAtoms(), d.getModel().getParams(), yy);
 	zeros();
-	d.fde->eval(dav, *this, 1);
+	if (d.fne)
+		d.fne->eval(dav, *this, 1);
+	else
+		d.fde->eval(dav, *this, 1);
 }
 
 void DynareJacobian::load(int i, int iord, const int* vars, double res)
@@ -344,14 +407,98 @@ void DynareJacobian::load(int i, int iord, const int* vars, double res)
 		throw DynareException(__FILE__, __LINE__,
 							  "Derivative order different from order=1 in DynareJacobian::load");
 
-	int t = vars[0];
-	int j = d.getModel().getAtoms().get_pos_of_all(t);
-	if (j < d.nyss())
-		get(i, j+d.nstat()+d.npred()) += res;
-	else if (j < d.nyss()+d.ny())
-		get(i, j-d.nyss()) += res;
-	else if (j < d.nyss()+d.ny()+d.nys())
-		get(i, j-d.nyss()-d.ny()+d.nstat()) += res;
+	int j = DynareSparseJacobian::column(d, vars[0]);
+	if (j >= 0)
+		get(i, j) += res;
+}
+
+void DynareJacobian::load_all(int iord, int n, const int* formulas, const int* vars,
+							  const double* res)
+{
+	if (iord != 1)
+		throw DynareException(__FILE__, __LINE__,
+							  "Derivative order different from order=1 in DynareJacobian::load_all");
+
+	for (int k = 0; k < n; k++) {
+		int j = DynareSparseJacobian::column(d, vars[k]);
+		if (j >= 0)
+			get(formulas[k], j) += res[k];
+	}
+}
+
+DynareSparseJacobian::DynareSparseJacobian(Dynare& dyn)
+	: SparseJacobian(dyn.ny(), pattern(dyn)), d(dyn)
+{
+}
+
+/** The variables y_{t+1}, y_t and y_{t-1} are all y in the static
+ * system, the exogenous variables are not in the Jacobian. */
+int DynareSparseJacobian::column(const Dynare& dyn, int t)
+{
+	int j = dyn.getModel().getAtoms().get_pos_of_all(t);
+	if (j < dyn.nyss())
+		return j+dyn.nstat()+dyn.npred();
+	else if (j < dyn.nyss()+dyn.ny())
+		return j-dyn.nyss();
+	else if (j < dyn.nyss()+dyn.ny()+dyn.nys())
+		return j-dyn.nyss()-dyn.ny()+dyn.nstat();
+	return -1;
+}
+
+vector<std::pair<int, int> > DynareSparseJacobian::pattern(const Dynare& dyn)
+{
+	const ogp::FormulaParser& eqs = dyn.getModel().getParser();
+	vector<int> vars = dyn.getModel().getAtoms().variables();
+	vector<bool> is_var(eqs.getTree().get_num_op(), false);
+	for (unsigned int k = 0; k < vars.size(); k++)
+		is_var[vars[k]] = true;
+	vector<std::pair<int, int> > res;
+	for (int i = 0; i < eqs.nformulas(); i++) {
+		ogp::NularySpan nuls = eqs.nulary_of_term(eqs.formula(i));
+		for (int k = 0; k < nuls.size(); k++)
+			if (nuls[k] < (int)is_var.size() && is_var[nuls[k]]) {
+				int j = column(dyn, nuls[k]);
+				if (j >= 0)
+					res.push_back(std::pair<int, int>(i, j));
+			}
+	}
+	return res;
+}
+
+void DynareSparseJacobian::eval(const Vector& yy)
+{
+	ogdyn::DynareSteadyAtomValues
+		dav(d.getModel().getAtoms(), d.getModel().getParams(), yy);
+	zeros();
+	if (d.fne)
+		d.fne->eval(dav, *this, 1);
+	else
+		d.fde->eval(dav, *this, 1);
+}
+
+void DynareSparseJacobian::load(int i, int iord, const int* vars, double res)
+{
+	if (iord != 1)
+		throw DynareException(__FILE__, __LINE__,
+							  "Derivative order different from order=1 in DynareSparseJacobian::load");
+
+	int j = column(d, vars[0]);
+	if (j >= 0)
+		get(i, j) += res;
+}
+
+void DynareSparseJacobian::load_all(int iord, int n, const int* formulas, const int* vars,
+									const double* res)
+{
+	if (iord != 1)
+		throw DynareException(__FILE__, __LINE__,
+							  "Derivative order different from order=1 in DynareSparseJacobian::load_all");
+
+	for (int k = 0; k < n; k++) {
+		int j = column(d, vars[k]);
+		if (j >= 0)
+			get(formulas[k], j) += res[k];
+	}
 }
 
 void DynareVectorFunction::eval(const ConstVector& in, Vector& out)
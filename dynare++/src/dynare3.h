@@ -10,6 +10,7 @@
 #include "../kord/dynamic_model.h"
 
 #include "dynare_model.h"
+#include "parser/cc/native_evaluator.h"
 #include "nlsolve.h"
 
 #include <vector>
@@ -77,12 +78,14 @@ public:
 // The following only implements DynamicModel with help of ogdyn::DynareModel
 
 class DynareJacobian;
+class DynareSparseJacobian;
 class Dynare : public DynamicModel
 {
   friend class DynareNameList;
   friend class DynareExogNameList;
   friend class DynareStateNameList;
   friend class DynareJacobian;
+  friend class DynareSparseJacobian;
   Journal &journal;
   ogdyn::DynareModel *model;
   Vector *ysteady;
@@ -92,7 +95,15 @@ class Dynare : public DynamicModel
   DynareStateNameList *dsnl;
   ogp::FormulaEvaluator *fe;
   ogp::FormulaDerEvaluator *fde;
+  /** The native evaluator, if used. */
+  ogp::FormulaNativeEvaluator *fne;
+  /** The cache directory of the native evaluator. */
+  std::string native_dir;
   const double ss_tol;
+  /** The number of endogenous variables from which the
+   * deterministic steady state is solved with the sparse
+   * Jacobian. */
+  static const int sparse_steady_dim = 200;
 public:
   /** Parses the given model file and uses the given order to
    * override order from the model file (if it is != -1). */
@@ -233,6 +244,17 @@ public:
                       const Vector &yyp, const Vector &xx);
   void calcDerivatives(const Vector &yy, const Vector &xx);
   void calcDerivativesAtSteady();
+  /** Generates, compiles and loads a native code evaluating the
+   * system and its derivatives, keeping the libraries in the given
+   * directory. If this fails, a warning is written to the journal
+   * and the interpreted evaluation is kept. */
+  void useNativeCode(const char *cache_dir);
+  /** Returns true if the native code is used. */
+  bool
+  usesNativeCode() const
+  {
+    return fne != NULL;
+  }
 
   void writeMat(mat_t *fd, const char *prefix) const;
   void writeDump(const std::string &basename) const;
@@ -260,6 +282,7 @@ public:
   DynareDerEvalLoader(const ogp::FineAtoms &a, TensorContainer<FSSparseTensor> &mod_ders,
                       int order);
   void load(int i, int iord, const int *vars, double res);
+  void load_all(int iord, int n, const int *formulas, const int *vars, const double *res);
 };
 
 class DynareJacobian : public ogu::Jacobian, public ogp::FormulaDerEvalLoader
@@ -272,9 +295,33 @@ public:
   {
   }
   void load(int i, int iord, const int *vars, double res);
+  void load_all(int iord, int n, const int *formulas, const int *vars, const double *res);
   void eval(const Vector &in);
 };
 
+/** This is the Jacobian of the static system evaluated by the
+ * derivative loader. The pattern is given by the nulary terms of
+ * the equations, each variable at any lead or lag gives a non-zero
+ * in the column of the variable. */
+class DynareSparseJacobian : public ogu::SparseJacobian, public ogp::FormulaDerEvalLoader
+{
+protected:
+  Dynare &d;
+public:
+  DynareSparseJacobian(Dynare &dyn);
+  virtual ~DynareSparseJacobian()
+  {
+  }
+  void load(int i, int iord, const int *vars, double res);
+  void load_all(int iord, int n, const int *formulas, const int *vars, const double *res);
+  void eval(const Vector &in);
+  /** Return the column of the variable given by the tree index, or
+   * -1 if the variable is exogenous. */
+  static int column(const Dynare &dyn, int t);
+protected:
+  static vector<std::pair<int, int> > pattern(const Dynare &dyn);
+};
+
 class DynareVectorFunction : public ogu::VectorFunction
 {
 protected:
@@ -8,6 +8,8 @@
 #include "planner_builder.h"
 #include "forw_subst_builder.h"
 
+#include "sthread.h"
+
 #include <cstdlib>
 
 #include <string>
@@ -194,10 +196,9 @@ void DynareModel::check_model() const
 	// either constant or assigned to a name
 	for (int i = 0; i < eqs.nformulas(); i++) {
 		int ft = eqs.formula(i);
-		const unordered_set<int>& nuls = eqs.nulary_of_term(ft);
-		for (unordered_set<int>::const_iterator it = nuls.begin();
-			 it != nuls.end(); ++it)
-			if (! atoms.is_constant(*it) && ! atoms.is_named_atom(*it))
+		ogp::NularySpan nuls = eqs.nulary_of_term(ft);
+		for (int k = 0; k < nuls.size(); k++)
+			if (! atoms.is_constant(nuls[k]) && ! atoms.is_named_atom(nuls[k]))
 				throw DynareException(__FILE__,__LINE__,
 									  "Dangling nulary term found, internal error.");
 	}
@@ -219,6 +220,50 @@ void DynareModel::check_model() const
 							  "Dimension of VCOV matrix does not correspond to the shocks");
 }
 
+/** This worker differentiates every step-th equation starting from
+ * the first one in its own copy of the tree. The copy is returned to
+ * its initial state after each equation. */
+class DiffWorker : public THREAD
+{
+	const ogp::FormulaParser& eqs;
+	const vector<int>& vars;
+	int first;
+	int step;
+	int order;
+	vector<ogp::FormulaDerivatives*>& fders;
+	vector<ogp::TreePatch>& patches;
+public:
+	DiffWorker(const ogp::FormulaParser& e, const vector<int>& v, int f, int s, int ord,
+			   vector<ogp::FormulaDerivatives*>& fd, vector<ogp::TreePatch>& p)
+		: eqs(e), vars(v), first(f), step(s), order(ord), fders(fd), patches(p) {}
+	void operator()()
+		{
+			ogp::OperationTree local(eqs.getTree());
+			for (int i = first; i < eqs.nformulas(); i += step)
+				fders[i] = eqs.differentiate_local(local, vars, i, order, patches[i]);
+		}
+};
+
+void DynareModel::differentiate(int ord)
+{
+	int nthreads = THREAD_GROUP::max_parallel_threads;
+	if (nthreads > eqs.nformulas())
+		nthreads = eqs.nformulas();
+	if (nthreads <= 1) {
+		eqs.differentiate(ord);
+		return;
+	}
+
+	vector<int> vars = atoms.variables();
+	vector<ogp::FormulaDerivatives*> fders(eqs.nformulas(), (ogp::FormulaDerivatives*)NULL);
+	vector<ogp::TreePatch> patches(eqs.nformulas());
+	THREAD_GROUP gr;
+	for (int i = 0; i < nthreads; i++)
+		gr.insert(new DiffWorker(eqs, vars, i, nthreads, ord, fders, patches));
+	gr.run();
+	eqs.merge_derivatives(fders, patches);
+}
+
 int DynareModel::variable_shift(int t, int tshift)
 {
 	const char* name = atoms.name(t);
@@ -240,13 +285,12 @@ int DynareModel::variable_shift(int t, int tshift)
 	return res;
 }
 
-void DynareModel::variable_shift_map(const unordered_set<int>& a_set, int tshift,
+void DynareModel::variable_shift_map(const ogp::NularySpan& a_set, int tshift,
 									 map<int,int>& s_map)
 {
 	s_map.clear();
-	for (unordered_set<int>::const_iterator it = a_set.begin();
-		 it != a_set.end(); ++it) {
-		int t = *it;
+	for (int k = 0; k < a_set.size(); k++) {
+		int t = a_set[k];
 		// make shift map only for non-constants and non-parameters
 		if (! atoms.is_constant(t)) {
 			const char* name = atoms.name(t);
@@ -263,13 +307,13 @@ void DynareModel::termspan(int t, int& mlead, int& mlag) const
 {
 	mlead = INT_MIN;
 	mlag = INT_MAX;
-	const unordered_set<int>& nul_terms = eqs.nulary_of_term(t);
-	for (unordered_set<int>::const_iterator ni = nul_terms.begin();
-		 ni != nul_terms.end(); ++ni) {
-		if (!atoms.is_constant(*ni) &&
-			(atoms.is_type(atoms.name(*ni), DynareDynamicAtoms::endovar) ||
-			 atoms.is_type(atoms.name(*ni), DynareDynamicAtoms::exovar))) {
-			int ll = atoms.lead(*ni);
+	ogp::NularySpan nul_terms = eqs.nulary_of_term(t);
+	for (int k = 0; k < nul_terms.size(); k++) {
+		int ni = nul_terms[k];
+		if (!atoms.is_constant(ni) &&
+			(atoms.is_type(atoms.name(ni), DynareDynamicAtoms::endovar) ||
+			 atoms.is_type(atoms.name(ni), DynareDynamicAtoms::exovar))) {
+			int ll = atoms.lead(ni);
 			if (ll < mlag)
 				mlag = ll;
 			if (ll > mlead)
@@ -280,11 +324,10 @@ void DynareModel::termspan(int t, int& mlead, int& mlag) const
 
 bool DynareModel::is_constant_term(int t) const
 {
-	const unordered_set<int>& nul_terms = eqs.nulary_of_term(t);
-	for (unordered_set<int>::const_iterator ni = nul_terms.begin();
-		 ni != nul_terms.end(); ++ni)
-		if (! atoms.is_constant(*ni) &&
-			! atoms.is_type(atoms.name(*ni), DynareDynamicAtoms::param))
+	ogp::NularySpan nul_terms = eqs.nulary_of_term(t);
+	for (int k = 0; k < nul_terms.size(); k++)
+		if (! atoms.is_constant(nul_terms[k]) &&
+			! atoms.is_type(atoms.name(nul_terms[k]), DynareDynamicAtoms::param))
 			return false;
 	return true;
 }
@@ -450,7 +493,7 @@ DynareParser::DynareParser(const char* stream, int len, int ord)
 
 	// differentiate
 	if (order >= 1)
-		eqs.differentiate(order);
+		differentiate(order);
 }
 
 DynareParser::DynareParser(const DynareParser& dp)
@@ -712,7 +755,7 @@ DynareSPModel::DynareSPModel(const char** endo, int num_endo,
 
 	// differentiate
 	if (order >= 1)
-		eqs.differentiate(order);
+		differentiate(order);
 }
 
 void ModelSSWriter::write_der0(FILE* fd)
@@ -198,6 +198,13 @@ namespace ogdyn
      * of endogenous variables and occurrrences of exogenous
      * variables. It throws an exception, if there is a problem. */
     void check_model() const;
+    /** This differentiates the equations up to the given
+     * order. The equations are distributed among
+     * THREAD_GROUP::max_parallel_threads threads, each
+     * differentiating in its own copy of the tree; the results are
+     * merged in the order of the equations, so the tree does not
+     * depend on the number of threads. */
+    void differentiate(int ord);
     /** This shifts the given variable identified by the tree
      * index in time. So if the given tree index represents a(+3)
      * and the tshift is -4, the method returns tree index of the
@@ -211,7 +218,7 @@ namespace ogdyn
      * variable in the given set to its time shifted variable. The
      * map is passed through the reference and is cleared in the
      * beginning. */
-    void variable_shift_map(const unordered_set<int> &a_set, int tshift,
+    void variable_shift_map(const ogp::NularySpan &a_set, int tshift,
                             map<int, int> &s_map);
     /** This returns maximum lead and minimum lag of an endogenous
      * or exogenous variable in the given term. If there are no
@@ -21,12 +21,16 @@ const char* help_str =
 "    --condper <num>      number of periods in cond. simulations [0]\n"
 "    --condsim <num>      number of conditional simulations [0]\n"
 "    --steps <num>        steps towards stoch. SS [0=deter.]\n"
+"    --steps-tol <num>    adaptive steps, stop when error within tol. [0=fixed]\n"
 "    --centralize         centralize the rule [do centralize]\n"
 "    --no-centralize      do not centralize the rule [do centralize]\n"
 "    --prefix <string>    prefix of variables in Mat-4 file [\"dyn\"]\n"
 "    --seed <num>         random number generator seed [934098]\n"
 "    --order <num>        order of approximation [no default]\n"
 "    --threads <num>      number of max parallel threads [2]\n"
+"    --tl-cache <file>    cache file of tensor library tables [none]\n"
+"    --save-rule <file>   save decision rule to binary file [none]\n"
+"    --native <dir>       compile model to native code cached in dir [none]\n"
 "    --ss-tol <num>       steady state calcs tolerance [1.e-13]\n"
 "    --check pesPES       check model residuals [no checks]\n"
 "                         lower/upper case switches off/on\n"
@@ -49,8 +53,8 @@ DynareParams::DynareParams(int argc, char** argv)
 	: modname(NULL), num_per(100), num_burn(0), num_sim(80), 
 	  num_rtper(0), num_rtsim(0),
 	  num_condper(0), num_condsim(0),
-	  num_threads(2), num_steps(0),
-	  prefix("dyn"), seed(934098), order(-1), ss_tol(1.e-13),
+	  num_threads(2), num_steps(0), steps_tol(0.0),
+	  prefix("dyn"), tl_cache(NULL), rule_file(NULL), native_dir(NULL), seed(934098), order(-1), ss_tol(1.e-13),
 	  check_along_path(false), check_along_shocks(false),
 	  check_on_ellipse(false), check_evals(1000), check_num(10), check_scale(2.0),
 	  do_irfs_all(true), do_centralize(true), qz_criterium(1.0+1e-6),
@@ -84,7 +88,11 @@ DynareParams::DynareParams(int argc, char** argv)
 		{"condsim", required_argument, NULL, opt_condsim},
 		{"prefix", required_argument, NULL, opt_prefix},
 		{"threads", required_argument, NULL, opt_threads},
+		{"tl-cache", required_argument, NULL, opt_tl_cache},
+		{"save-rule", required_argument, NULL, opt_save_rule},
+		{"native", required_argument, NULL, opt_native},
 		{"steps", required_argument, NULL, opt_steps},
+		{"steps-tol", required_argument, NULL, opt_steps_tol},
 		{"seed", required_argument, NULL, opt_seed},
 		{"order", required_argument, NULL, opt_order},
 		{"ss-tol", required_argument, NULL, opt_ss_tol},
@@ -141,10 +149,23 @@ DynareParams::DynareParams(int argc, char** argv)
 			if (1 != sscanf(optarg, "%d", &num_threads))
 				fprintf(stderr, "Couldn't parse integer %s, ignored\n", optarg);
 			break;
+		case opt_tl_cache:
+			tl_cache = optarg;
+			break;
+		case opt_save_rule:
+			rule_file = optarg;
+			break;
+		case opt_native:
+			native_dir = optarg;
+			break;
 		case opt_steps:
 			if (1 != sscanf(optarg, "%d", &num_steps))
 				fprintf(stderr, "Couldn't parse integer %s, ignored\n", optarg);
 			break;
+		case opt_steps_tol:
+			if (1 != sscanf(optarg, "%lf", &steps_tol))
+				fprintf(stderr, "Couldn't parse float %s, ignored\n", optarg);
+			break;
 		case opt_seed:
 			if (1 != sscanf(optarg, "%d", &seed))
 				fprintf(stderr, "Couldn't parse integer %s, ignored\n", optarg);
@@ -26,7 +26,15 @@ struct DynareParams
   int num_condsim;
   int num_threads;
   int num_steps;
+  /** Tolerance of the adaptive walk to the stochastic steady state, zero for fixed steps. */
+  double steps_tol;
   const char *prefix;
+  /** File caching the equivalence sets of the tensor library. */
+  const char *tl_cache;
+  /** Binary file the folded decision rule is saved to. */
+  const char *rule_file;
+  /** Directory of the compiled native code of the model. */
+  const char *native_dir;
   int seed;
   int order;
   /** Tolerance used for steady state calcs. */
@@ -74,8 +82,8 @@ struct DynareParams
   }
 private:
   enum {opt_per, opt_burn, opt_sim, opt_rtper, opt_rtsim, opt_condper, opt_condsim,
-        opt_prefix, opt_threads,
-        opt_steps, opt_seed, opt_order, opt_ss_tol, opt_check,
+        opt_prefix, opt_threads, opt_tl_cache, opt_save_rule, opt_native,
+        opt_steps, opt_steps_tol, opt_seed, opt_order, opt_ss_tol, opt_check,
         opt_check_along_path, opt_check_along_shocks, opt_check_on_ellipse,
         opt_check_evals, opt_check_scale, opt_check_num, opt_noirfs, opt_irfs,
         opt_help, opt_version, opt_centralize, opt_no_centralize, opt_qz_criterium};
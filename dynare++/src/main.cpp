@@ -38,6 +38,8 @@ int main(int argc, char** argv)
 
 		// make dynare object
 		Dynare dynare(params.modname, params.order, params.ss_tol, journal);
+		if (params.native_dir)
+			dynare.useNativeCode(params.native_dir);
 		// make list of shocks for which we will do IRFs
         vector<int> irf_list_ind;
 		if (params.do_irfs_all)
@@ -87,9 +89,10 @@ int main(int argc, char** argv)
 
 		tls.init(dynare.order(),
 				 dynare.nstat()+2*dynare.npred()+3*dynare.nboth()+
-				 2*dynare.nforw()+dynare.nexog());
+				 2*dynare.nforw()+dynare.nexog(), params.tl_cache);
 
 		Approximation app(dynare, journal, params.num_steps, params.do_centralize, params.qz_criterium);
+		app.setWalkTolerance(params.steps_tol);
 		try {
 			app.walkStochSteady();
 		} catch (const KordException& e) {
@@ -127,6 +130,8 @@ int main(int argc, char** argv)
 
 		// write the folded decision rule to the Mat-4 file
 		app.getFoldDecisionRule().writeMat(matfd, params.prefix);
+		if (params.rule_file)
+			app.getFoldDecisionRule().save(params.rule_file);
 
 		// simulate conditional
 		if (params.num_condper > 0 && params.num_condsim > 0) {
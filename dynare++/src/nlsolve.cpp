@@ -6,6 +6,7 @@
 #include "dynare_exception.h"
 
 #include <cmath>
+#include <algorithm>
 
 using namespace ogu;
 
@@ -191,20 +192,33 @@ bool NLSolver::solve(Vector& xx, int& iter)
 	rec2 << iter << "         N/A   " << tmpbuf << endrec;
 	while (! converged && iter < max_iter) {
 		// setup Jacobian
-		jacob.eval(x);
+		if (sjacob) {
+			sjacob->eval(x);
+			slu->update(*sjacob);
+		} else
+			jacob->eval(x);
 		// calculate cauchy step
 		Vector g(func.inDim());
 		g.zeros();
-		ConstTwoDMatrix(jacob).multaVecTrans(g, fx);
+		if (sjacob)
+			sjacob->multaVecTrans(g, fx);
+		else
+			ConstTwoDMatrix(*jacob).multaVecTrans(g, fx);
 		Vector Jg(func.inDim());
 		Jg.zeros();
-		ConstTwoDMatrix(jacob).multaVec(Jg, g);
+		if (sjacob)
+			sjacob->multaVec(Jg, g);
+		else
+			ConstTwoDMatrix(*jacob).multaVec(Jg, g);
 		double m = -g.dot(g)/Jg.dot(Jg);
 		xcauchy = (const Vector&) g;
 		xcauchy.mult(m);
 		// calculate newton step
 		xnewton = (const Vector&) fx;
-		ConstTwoDMatrix(jacob).multInvLeft(xnewton);
+		if (sjacob)
+			slu->multInvLeft(xnewton);
+		else
+			ConstTwoDMatrix(*jacob).multInvLeft(xnewton);
 		xnewton.mult(-1);
 
 		// line search
@@ -224,5 +238,263 @@ bool NLSolver::solve(Vector& xx, int& iter)
 	}
 	xx = (const Vector&)x;
 
+	if (sjacob) {
+		JournalRecord rec4(journal);
+		rec4 << "Sparse LU: " << slu->getNumFactor() << " factorizations, "
+			 << slu->getNumRefactor() << " refactorizations, "
+			 << slu->getNumNonZero() << " non-zeros" << endrec;
+	}
+
 	return converged;
 }
+
+SparseJacobian::SparseJacobian(int nn, const vector<std::pair<int, int> >& pattern)
+	: n(nn), colptr(nn+1, 0)
+{
+	vector<std::pair<int, int> > p;
+	p.reserve(pattern.size());
+	for (unsigned int k = 0; k < pattern.size(); k++) {
+		if (pattern[k].first < 0 || pattern[k].first >= n
+			|| pattern[k].second < 0 || pattern[k].second >= n)
+			throw DynareException(__FILE__, __LINE__,
+								  "Element out of dimension in SparseJacobian constructor");
+		p.push_back(std::pair<int, int>(pattern[k].second, pattern[k].first));
+	}
+	std::sort(p.begin(), p.end());
+	p.erase(std::unique(p.begin(), p.end()), p.end());
+	rowind.resize(p.size());
+	for (unsigned int k = 0; k < p.size(); k++) {
+		rowind[k] = p[k].second;
+		colptr[p[k].first+1]++;
+	}
+	for (int j = 0; j < n; j++)
+		colptr[j+1] += colptr[j];
+	vals.resize(p.size(), 0.0);
+}
+
+void SparseJacobian::zeros()
+{
+	std::fill(vals.begin(), vals.end(), 0.0);
+}
+
+double& SparseJacobian::get(int i, int j)
+{
+	vector<int>::const_iterator b = rowind.begin()+colptr[j];
+	vector<int>::const_iterator e = rowind.begin()+colptr[j+1];
+	vector<int>::const_iterator it = std::lower_bound(b, e, i);
+	if (it == e || *it != i)
+		throw DynareException(__FILE__, __LINE__,
+							  "Element not in the pattern in SparseJacobian::get");
+	return vals[it - rowind.begin()];
+}
+
+void SparseJacobian::multaVec(Vector& y, const ConstVector& x) const
+{
+	for (int j = 0; j < n; j++)
+		for (int k = colptr[j]; k < colptr[j+1]; k++)
+			y[rowind[k]] += vals[k]*x[j];
+}
+
+void SparseJacobian::multaVecTrans(Vector& y, const ConstVector& x) const
+{
+	for (int j = 0; j < n; j++) {
+		double s = 0.0;
+		for (int k = colptr[j]; k < colptr[j+1]; k++)
+			s += vals[k]*x[rowind[k]];
+		y[j] += s;
+	}
+}
+
+/** A pivot is refused by refactor() if it is smaller than this
+ * fraction of the largest element of its column. */
+const double SparseLU::pivot_tol = 0.01;
+
+/** The diagonal element is taken as a pivot if it is not smaller
+ * than this fraction of the largest candidate. */
+const double SparseLU::diag_pref = 0.1;
+
+SparseLU::SparseLU(int nn)
+	: n(nn), q(nn), prow(nn), pinv(nn), lptr(nn+1, 0), uptr(nn+1, 0),
+	  udiag(nn), work(nn, 0.0), factored(false), nfactor(0), nrefactor(0)
+{
+}
+
+/** This is the left looking algorithm of Gilbert and Peierls. For
+ * each column, the steps which update it are found by a depth first
+ * search in the graph of L from the non-zeros of the column, the
+ * reverse post order of the search is the order in which the updates
+ * are done. The remaining non-zeros are candidates for the pivot. No
+ * values are dropped, so the patterns of L and U depend only on the
+ * pattern of the Jacobian and on the pivots. */
+void SparseLU::factor(const SparseJacobian& j)
+{
+	if (j.n != n)
+		throw DynareException(__FILE__, __LINE__,
+							  "Wrong dimension in SparseLU::factor");
+
+	// order the columns by increasing number of non-zeros
+	vector<std::pair<int, int> > cnt(n);
+	for (int c = 0; c < n; c++)
+		cnt[c] = std::pair<int, int>(j.colptr[c+1]-j.colptr[c], c);
+	std::stable_sort(cnt.begin(), cnt.end());
+	for (int c = 0; c < n; c++)
+		q[c] = cnt[c].second;
+
+	std::fill(pinv.begin(), pinv.end(), -1);
+	lrow.clear(); lval.clear(); urow.clear(); uval.clear();
+	vector<int> mark(n, -1);   // stamp of the steps visited by the search
+	vector<int> rmark(n, -1);  // stamp of the rows in the pattern of the column
+	vector<int> rows;          // the rows in the pattern of the column
+	vector<int> post;          // post order of the search
+	vector<std::pair<int, int> > stack;
+	for (int s = 0; s < n; s++) {
+		int c = q[s];
+		rows.clear();
+		post.clear();
+		// scatter the column and search for the updating steps
+		for (int k = j.colptr[c]; k < j.colptr[c+1]; k++) {
+			int r = j.rowind[k];
+			work[r] = j.vals[k];
+			if (rmark[r] != s) {
+				rmark[r] = s;
+				rows.push_back(r);
+			}
+			if (pinv[r] >= 0 && mark[pinv[r]] != s) {
+				mark[pinv[r]] = s;
+				stack.push_back(std::pair<int, int>(pinv[r], lptr[pinv[r]]));
+				while (! stack.empty()) {
+					int st = stack.back().first;
+					int& next = stack.back().second;
+					if (next < lptr[st+1]) {
+						int rr = lrow[next++];
+						if (rmark[rr] != s) {
+							rmark[rr] = s;
+							work[rr] = 0.0;
+							rows.push_back(rr);
+						}
+						if (pinv[rr] >= 0 && mark[pinv[rr]] != s) {
+							mark[pinv[rr]] = s;
+							stack.push_back(std::pair<int, int>(pinv[rr], lptr[pinv[rr]]));
+						}
+					} else {
+						post.push_back(st);
+						stack.pop_back();
+					}
+				}
+			}
+		}
+		// do the updates in the topological order and store U
+		for (int k = (int)post.size()-1; k >= 0; k--) {
+			int st = post[k];
+			double u = work[prow[st]];
+			for (int l = lptr[st]; l < lptr[st+1]; l++)
+				work[lrow[l]] -= lval[l]*u;
+			urow.push_back(st);
+			uval.push_back(u);
+		}
+		uptr[s+1] = urow.size();
+		// choose the pivot among the rows not pivotal yet
+		int piv = -1;
+		double maxabs = 0.0;
+		for (unsigned int k = 0; k < rows.size(); k++)
+			if (pinv[rows[k]] < 0 && (piv < 0 || std::abs(work[rows[k]]) > maxabs)) {
+				piv = rows[k];
+				maxabs = std::abs(work[piv]);
+			}
+		if (piv >= 0 && rmark[c] == s && pinv[c] < 0
+			&& std::abs(work[c]) >= diag_pref*maxabs)
+			piv = c;
+		if (piv < 0) {
+			// structurally singular column, take any free row
+			piv = 0;
+			while (pinv[piv] >= 0)
+				piv++;
+			rmark[piv] = s;
+			work[piv] = 0.0;
+			rows.push_back(piv);
+		}
+		prow[s] = piv;
+		pinv[piv] = s;
+		udiag[s] = work[piv];
+		// store L
+		for (unsigned int k = 0; k < rows.size(); k++) {
+			int r = rows[k];
+			if (pinv[r] < 0) {
+				lrow.push_back(r);
+				lval.push_back(work[r]/udiag[s]);
+			}
+		}
+		lptr[s+1] = lrow.size();
+	}
+	factored = true;
+	nfactor++;
+}
+
+/** The rows of the pattern of a column are the pivot rows of the
+ * steps in U, the pivot row of the column and the rows in L. */
+bool SparseLU::refactor(const SparseJacobian& j)
+{
+	if (! factored || j.n != n)
+		return false;
+
+	for (int s = 0; s < n; s++) {
+		int c = q[s];
+		for (int k = uptr[s]; k < uptr[s+1]; k++)
+			work[prow[urow[k]]] = 0.0;
+		work[prow[s]] = 0.0;
+		for (int k = lptr[s]; k < lptr[s+1]; k++)
+			work[lrow[k]] = 0.0;
+		for (int k = j.colptr[c]; k < j.colptr[c+1]; k++)
+			work[j.rowind[k]] = j.vals[k];
+		for (int k = uptr[s]; k < uptr[s+1]; k++) {
+			int st = urow[k];
+			double u = work[prow[st]];
+			for (int l = lptr[st]; l < lptr[st+1]; l++)
+				work[lrow[l]] -= lval[l]*u;
+			uval[k] = u;
+		}
+		double d = work[prow[s]];
+		double maxabs = std::abs(d);
+		for (int k = lptr[s]; k < lptr[s+1]; k++)
+			maxabs = std::max(maxabs, std::abs(work[lrow[k]]));
+		if (d == 0.0 || std::abs(d) < pivot_tol*maxabs) {
+			factored = false;
+			return false;
+		}
+		udiag[s] = d;
+		for (int k = lptr[s]; k < lptr[s+1]; k++)
+			lval[k] = work[lrow[k]]/d;
+	}
+	nrefactor++;
+	return true;
+}
+
+void SparseLU::update(const SparseJacobian& j)
+{
+	if (! refactor(j))
+		factor(j);
+}
+
+void SparseLU::multInvLeft(Vector& x) const
+{
+	if (x.length() != n)
+		throw DynareException(__FILE__, __LINE__,
+							  "Wrong dimension in SparseLU::multInvLeft");
+	// solve Ly = Pb, y is indexed by steps
+	vector<double> b(n);
+	for (int r = 0; r < n; r++)
+		b[r] = x[r];
+	vector<double> y(n);
+	for (int s = 0; s < n; s++) {
+		y[s] = b[prow[s]];
+		for (int l = lptr[s]; l < lptr[s+1]; l++)
+			b[lrow[l]] -= lval[l]*y[s];
+	}
+	// solve Uz = y, and permute the columns back
+	for (int s = n-1; s >= 0; s--) {
+		double z = y[s]/udiag[s];
+		for (int k = uptr[s]; k < uptr[s+1]; k++)
+			y[urow[k]] -= uval[k]*z;
+		x[q[s]] = z;
+	}
+}
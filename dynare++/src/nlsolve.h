@@ -8,8 +8,11 @@
 #include "twod_matrix.h"
 #include "journal.h"
 
+#include <vector>
+
 namespace ogu
 {
+  using std::vector;
 
   class OneDFunction
   {
@@ -73,12 +76,122 @@ namespace ogu
     virtual void eval(const Vector &in) = 0;
   };
 
+  /** This is a square Jacobian with a fixed sparsity pattern. The
+   * pattern is given by the (row, column) pairs in the constructor,
+   * a pair may be given more than once. The elements are stored by
+   * columns, the rows of each column are sorted. The eval() is
+   * supposed to zero the elements and then set or add to them
+   * through get(), which throws if the element is not in the
+   * pattern. */
+  class SparseJacobian
+  {
+    friend class SparseLU;
+  protected:
+    int n;
+    vector<int> colptr;
+    vector<int> rowind;
+    vector<double> vals;
+  public:
+    SparseJacobian(int nn, const vector<std::pair<int, int> > &pattern);
+    virtual ~SparseJacobian()
+    {
+    }
+    virtual void eval(const Vector &in) = 0;
+    int
+    nrows() const
+    {
+      return n;
+    }
+    int
+    getNumNonZero() const
+    {
+      return (int) rowind.size();
+    }
+    void zeros();
+    double &get(int i, int j);
+    /** y = y + J*x */
+    void multaVec(Vector &y, const ConstVector &x) const;
+    /** y = y + J^T*x */
+    void multaVecTrans(Vector &y, const ConstVector &x) const;
+  };
+
+  /** This is a sparse LU factorization of a SparseJacobian,
+   * PJQ=LU, computed column by column (left looking) with a
+   * threshold partial pivoting preferring the diagonal. The columns
+   * are ordered by increasing number of non-zeros.
+   *
+   * Since the pattern of the Jacobian does not change, refactor()
+   * reuses the pivots and the patterns of L and U of the last
+   * factor() and only recomputes the values. If a pivot becomes
+   * too small with respect to its column, refactor() fails and the
+   * full factorization must be done. This policy is implemented in
+   * update(). */
+  class SparseLU
+  {
+  protected:
+    int n;
+    /** The column ordering. */
+    vector<int> q;
+    /** Pivot row of each step, and its inverse. */
+    vector<int> prow;
+    vector<int> pinv;
+    /** The strictly lower part of L by columns, in the original
+     * row numbering. */
+    vector<int> lptr;
+    vector<int> lrow;
+    vector<double> lval;
+    /** The strictly upper part of U by columns, the rows are steps
+     * in the order in which they were eliminated. */
+    vector<int> uptr;
+    vector<int> urow;
+    vector<double> uval;
+    /** The diagonal of U. */
+    vector<double> udiag;
+    /** Work array indexed by rows. */
+    vector<double> work;
+    bool factored;
+    int nfactor;
+    int nrefactor;
+    static const double pivot_tol;
+    static const double diag_pref;
+  public:
+    SparseLU(int nn);
+    /** Factorize the matrix with pivoting. */
+    void factor(const SparseJacobian &j);
+    /** Factorize the matrix with the pivots and patterns of the
+     * last factor(), return false if it failed. */
+    bool refactor(const SparseJacobian &j);
+    /** Refactor if possible, factor otherwise. */
+    void update(const SparseJacobian &j);
+    /** x = inv(J)*x */
+    void multInvLeft(Vector &x) const;
+    int
+    getNumFactor() const
+    {
+      return nfactor;
+    }
+    int
+    getNumRefactor() const
+    {
+      return nrefactor;
+    }
+    int
+    getNumNonZero() const
+    {
+      return (int) (lrow.size()+urow.size()) + n;
+    }
+  };
+
   class NLSolver : public OneDFunction
   {
   protected:
     Journal &journal;
     VectorFunction &func;
-    Jacobian &jacob;
+    /** Either the dense Jacobian, or the sparse Jacobian and its
+     * factorization are used. */
+    Jacobian *jacob;
+    SparseJacobian *sjacob;
+    SparseLU *slu;
     const int max_iter;
     const double tol;
   private:
@@ -87,13 +200,23 @@ namespace ogu
     Vector x;
   public:
     NLSolver(VectorFunction &f, Jacobian &j, int maxit, double tl, Journal &jr)
-      : journal(jr), func(f), jacob(j), max_iter(maxit), tol(tl),
+      : journal(jr), func(f), jacob(&j), sjacob(NULL), slu(NULL),
+        max_iter(maxit), tol(tl),
+        xnewton(f.inDim()), xcauchy(f.inDim()), x(f.inDim())
+    {
+      xnewton.zeros(); xcauchy.zeros(); x.zeros();
+    }
+    NLSolver(VectorFunction &f, SparseJacobian &j, int maxit, double tl, Journal &jr)
+      : journal(jr), func(f), jacob(NULL), sjacob(&j), slu(new SparseLU(j.nrows())),
+        max_iter(maxit), tol(tl),
         xnewton(f.inDim()), xcauchy(f.inDim()), x(f.inDim())
     {
       xnewton.zeros(); xcauchy.zeros(); x.zeros();
     }
     virtual ~NLSolver()
     {
+      if (slu)
+        delete slu;
     }
     /** Returns true if the problem has converged. xx as input is the
      * starting value, as output it is a solution. */
@@ -103,6 +226,8 @@ namespace ogu
      * xx=x+lambda*xcauchy+(1-lambda)*xnewton. It is non-const only
      * because it calls func, x, xnewton, xcauchy is not changed. */
     double eval(double lambda);
+  private:
+    NLSolver(const NLSolver &);
   };
 
 };
@@ -0,0 +1,555 @@
+// Tests of the sparse Jacobian and LU, and of NLSolver using them,
+// and of the differentiation and the native evaluation of a model.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+#include <algorithm>
+
+#include <sys/stat.h>
+
+#include "nlsolve.h"
+#include "dynare3.h"
+#include "dynare_exception.h"
+#include "SylvException.h"
+#include "utils/cc/exception.h"
+
+using namespace ogu;
+
+// a sparse Jacobian whose values are set directly by the tests
+class ValSparseJacobian : public SparseJacobian {
+public:
+	ValSparseJacobian(int nn, const vector<std::pair<int, int> >& pattern)
+		: SparseJacobian(nn, pattern) {}
+	void eval(const Vector& in) {}
+	// copy the values to a dense matrix
+	void toDense(TwoDMatrix& d) const
+		{
+			d.zeros();
+			for (int j = 0; j < n; j++)
+				for (int k = colptr[j]; k < colptr[j+1]; k++)
+					d.get(rowind[k], j) = vals[k];
+		}
+	// multiply all values by 1+p*e, where e is uniform in (-1,1)
+	void perturb(double p)
+		{
+			for (unsigned int k = 0; k < vals.size(); k++)
+				vals[k] *= 1.0 + p*(2.0*rand()/RAND_MAX - 1.0);
+		}
+};
+
+// a sparse LU with an access to the first pivot
+class PivotSparseLU : public SparseLU {
+public:
+	PivotSparseLU(int nn)
+		: SparseLU(nn) {}
+	int firstPivotRow() const
+		{return prow[0];}
+	int firstPivotCol() const
+		{return q[0];}
+};
+
+// the function x_i + x_i^3/2 + a*(x_{i-1}+x_{i+1}) + b*x_{p(i)} - r_i
+// where p is a permutation, with its dense and sparse Jacobians
+class TestFunction : public VectorFunction {
+	int n;
+	double a;
+	double b;
+	Vector r;
+public:
+	TestFunction(int nn, double aa, double bb)
+		: n(nn), a(aa), b(bb), r(nn)
+		{
+			for (int i = 0; i < n; i++)
+				r[i] = 1.0 + 0.5*sin(1.0*i);
+		}
+	int inDim() const
+		{return n;}
+	int outDim() const
+		{return n;}
+	int perm(int i) const
+		{return (7*i+3) % n;}
+	void eval(const ConstVector& in, Vector& out)
+		{
+			check_for_eval(in, out);
+			for (int i = 0; i < n; i++) {
+				double x = in[i];
+				out[i] = x + 0.5*x*x*x - r[i] + b*in[perm(i)];
+				if (i > 0)
+					out[i] += a*in[i-1];
+				if (i < n-1)
+					out[i] += a*in[i+1];
+			}
+		}
+	// add the derivatives to the element (i,j) by calling f(i,j,value)
+	template <class F>
+	void derivs(const Vector& in, F& f) const
+		{
+			for (int i = 0; i < n; i++) {
+				f(i, i) += 1.0 + 1.5*in[i]*in[i];
+				f(i, perm(i)) += b;
+				if (i > 0)
+					f(i, i-1) += a;
+				if (i < n-1)
+					f(i, i+1) += a;
+			}
+		}
+	vector<std::pair<int, int> > pattern() const
+		{
+			vector<std::pair<int, int> > p;
+			for (int i = 0; i < n; i++) {
+				p.push_back(std::pair<int, int>(i, i));
+				p.push_back(std::pair<int, int>(i, perm(i)));
+				if (i > 0)
+					p.push_back(std::pair<int, int>(i, i-1));
+				if (i < n-1)
+					p.push_back(std::pair<int, int>(i, i+1));
+			}
+			return p;
+		}
+};
+
+class TestJacobian : public Jacobian {
+	const TestFunction& f;
+public:
+	TestJacobian(const TestFunction& ff)
+		: Jacobian(ff.inDim()), f(ff) {}
+	void eval(const Vector& in)
+		{
+			zeros();
+			f.derivs(in, *this);
+		}
+	double& operator()(int i, int j)
+		{return get(i, j);}
+};
+
+class TestSparseJacobian : public SparseJacobian {
+	const TestFunction& f;
+public:
+	TestSparseJacobian(const TestFunction& ff)
+		: SparseJacobian(ff.inDim(), ff.pattern()), f(ff) {}
+	void eval(const Vector& in)
+		{
+			zeros();
+			f.derivs(in, *this);
+		}
+	double& operator()(int i, int j)
+		{return get(i, j);}
+};
+
+class TestRunnable {
+	char name[100];
+public:
+	TestRunnable(const char* n)
+		{strncpy(name, n, 100);}
+	virtual ~TestRunnable() {}
+	bool test() const;
+	virtual bool run() const =0;
+	const char* getName() const
+		{return name;}
+protected:
+	static double lu_solve_err(const SparseLU& lu, const TwoDMatrix& d, int nrhs);
+	static double sparse_lu(int n, int nnz_per_col, int nrefactor);
+	static double nl_solve(int n, double a, double b);
+	static double max_diff(const Vector& a, const Vector& b);
+	static double max_diff(const TensorContainer<FSSparseTensor>& a,
+						   const TensorContainer<FSSparseTensor>& b);
+	static bool write_model(const char* fname);
+	static double diff_threads(int nthreads);
+	static double native_eval(const char* cache_dir, const char* cc);
+};
+
+bool TestRunnable::test() const
+{
+	printf("Running test <%s>\n",name);
+	clock_t start = clock();
+	bool passed = run();
+	clock_t end = clock();
+	printf("CPU time %8.4g (CPU seconds)..................",
+		   ((double)(end-start))/CLOCKS_PER_SEC);
+	if (passed) {
+		printf("passed\n\n");
+		return passed;
+	} else {
+		printf("FAILED\n\n");
+		return passed;
+	}
+}
+
+// maximum difference of the sparse and the dense solutions for the
+// given number of right hand sides, relative to the dense solution
+double TestRunnable::lu_solve_err(const SparseLU& lu, const TwoDMatrix& d, int nrhs)
+{
+	int n = d.nrows();
+	double res = 0.0;
+	for (int i = 0; i < nrhs; i++) {
+		Vector x(n);
+		for (int k = 0; k < n; k++)
+			x[k] = 2.0*rand()/RAND_MAX - 1.0;
+		Vector xd((const Vector&)x);
+		lu.multInvLeft(x);
+		ConstTwoDMatrix(d).multInvLeft(xd);
+		x.add(-1.0, xd);
+		res = std::max(res, x.getMax()/(1.0+xd.getMax()));
+	}
+	return res;
+}
+
+// factor a random sparse matrix, refactor it a given number of times
+// with perturbed values, and finally make the first pivot zero, so
+// that the refactorization fails and the update factors anew; the
+// solutions are compared to the dense ones after each step
+double TestRunnable::sparse_lu(int n, int nnz_per_col, int nrefactor)
+{
+	srand(1);
+	vector<std::pair<int, int> > pattern;
+	for (int j = 0; j < n; j++) {
+		// a shifted diagonal makes the matrix non-singular for
+		// almost all values, and moves the pivots off the diagonal
+		pattern.push_back(std::pair<int, int>((j+3) % n, j));
+		for (int k = 1; k < nnz_per_col; k++)
+			pattern.push_back(std::pair<int, int>(rand() % n, j));
+	}
+	ValSparseJacobian j(n, pattern);
+	for (unsigned int k = 0; k < pattern.size(); k++)
+		j.get(pattern[k].first, pattern[k].second) = 2.0*rand()/RAND_MAX - 1.0;
+	for (int k = 0; k < n; k++)
+		j.get((k+3) % n, k) += 4.0;
+	TwoDMatrix d(n, n);
+
+	PivotSparseLU lu(n);
+	lu.factor(j);
+	j.toDense(d);
+	double err = lu_solve_err(lu, d, 5);
+	printf("\tnon-zeros in J and in LU:     %d %d\n", j.getNumNonZero(), lu.getNumNonZero());
+	printf("\terror of factor:              %10.6g\n", err);
+
+	bool refactored = true;
+	for (int i = 0; i < nrefactor; i++) {
+		j.perturb(0.1);
+		refactored = lu.refactor(j) && refactored;
+		j.toDense(d);
+		double e = lu_solve_err(lu, d, 5);
+		printf("\terror of refactor %d:          %10.6g\n", i+1, e);
+		err = std::max(err, e);
+	}
+
+	j.get(lu.firstPivotRow(), lu.firstPivotCol()) = 0.0;
+	bool refused = ! lu.refactor(j);
+	lu.update(j);
+	j.toDense(d);
+	double e = lu_solve_err(lu, d, 5);
+	printf("\terror of update after refusal: %10.6g\n", e);
+	err = std::max(err, e);
+
+	printf("\tfactors, refactors:           %d %d\n", lu.getNumFactor(), lu.getNumRefactor());
+	if (! refactored || ! refused || lu.getNumFactor() != 2 || lu.getNumRefactor() != nrefactor)
+		err = 1.0;
+	return err;
+}
+
+// solve the test function with the dense and the sparse Jacobian
+// and return the difference of the solutions
+double TestRunnable::nl_solve(int n, double a, double b)
+{
+	Journal journal("nlsolve.jnl");
+	TestFunction f(n, a, b);
+
+	TestJacobian dj(f);
+	NLSolver dnls(f, dj, 500, 1.e-12, journal);
+	Vector xd(n);
+	xd.zeros();
+	int iterd;
+	bool convd = dnls.solve(xd, iterd);
+
+	TestSparseJacobian sj(f);
+	NLSolver snls(f, sj, 500, 1.e-12, journal);
+	Vector xs(n);
+	xs.zeros();
+	int iters;
+	bool convs = snls.solve(xs, iters);
+
+	Vector res(n);
+	f.eval(xs, res);
+	xs.add(-1.0, xd);
+	double err = xs.getMax();
+	printf("\tdense iterations, converged:  %d %s\n", iterd, convd? "yes" : "no");
+	printf("\tsparse iterations, converged: %d %s\n", iters, convs? "yes" : "no");
+	printf("\tresidual of sparse solution:  %10.6g\n", res.getMax());
+	printf("\tdifference of solutions:      %10.6g\n", err);
+	if (! convd || ! convs)
+		err = 1.0;
+	return err;
+}
+
+// the model of example1.mod
+static const char* native_model =
+	"var Y, C, K, A, H, B;\n"
+	"varexo EPS, NU;\n"
+	"parameters rho, beta, alpha, delta, theta, psi, tau;\n"
+	"alpha = 0.36; rho = 0.95; tau = 0.025; beta = 1/(1.03^0.25);\n"
+	"delta = 0.025; psi = 0; theta = 2.95;\n"
+	"model;\n"
+	"C*theta*H^(1+psi) = (1-alpha)*Y;\n"
+	"beta*exp(B)*C/exp(B(1))/C(1)*(exp(B(1))*alpha*Y(1)/K(1)+1-delta) = 1;\n"
+	"Y = exp(A)*K^alpha*H^(1-alpha);\n"
+	"K = exp(B(-1))*(Y(-1)-C(-1)) + (1-delta)*K(-1);\n"
+	"A = rho*A(-1) + tau*B(-1) + EPS;\n"
+	"B = tau*A(-1) + rho*B(-1) + NU;\n"
+	"end;\n"
+	"initval;\n"
+	"A = 0; B = 0;\n"
+	"H = ((1-alpha)/(theta*(1-(delta*alpha)/(1/beta-1+delta))))^(1/(1+psi));\n"
+	"Y = (alpha/(1/beta-1+delta))^(alpha/(1-alpha))*H;\n"
+	"K = alpha/(1/beta-1+delta)*Y;\n"
+	"C = Y - delta*K;\n"
+	"end;\n"
+	"vcov = [0.0002 0.00005; 0.00005 0.0001];\n"
+	"order = 3;\n";
+
+bool TestRunnable::write_model(const char* fname)
+{
+	FILE* fd = fopen(fname, "w");
+	if (fd == NULL)
+		return false;
+	fputs(native_model, fd);
+	fclose(fd);
+	return true;
+}
+
+// maximum difference of the vectors relative to the first one
+double TestRunnable::max_diff(const Vector& a, const Vector& b)
+{
+	Vector d((const Vector&)b);
+	d.add(-1.0, a);
+	return d.getMax()/(1.0+a.getMax());
+}
+
+// maximum difference of the sparse tensors of all dimensions
+// relative to the first ones, 1 if the non-zero patterns differ
+double TestRunnable::max_diff(const TensorContainer<FSSparseTensor>& a,
+							  const TensorContainer<FSSparseTensor>& b)
+{
+	double res = 0.0;
+	for (int dim = 1; a.check(Symmetry(dim)); dim++) {
+		if (! b.check(Symmetry(dim)))
+			return 1.0;
+		const FSSparseTensor::Map& ma = a.get(Symmetry(dim))->getMap();
+		const FSSparseTensor::Map& mb = b.get(Symmetry(dim))->getMap();
+		if (ma.size() != mb.size())
+			return 1.0;
+		FSSparseTensor::const_iterator ita = ma.begin();
+		FSSparseTensor::const_iterator itb = mb.begin();
+		for (; ita != ma.end(); ++ita, ++itb) {
+			if ((*ita).first != (*itb).first || (*ita).second.first != (*itb).second.first)
+				return 1.0;
+			double x = (*ita).second.second;
+			double y = (*itb).second.second;
+			res = std::max(res, fabs(x-y)/(1.0+fabs(x)));
+		}
+	}
+	return res;
+}
+
+// differentiate the model serially and twice with the given number
+// of threads, and evaluate the derivatives in a point off the steady
+// state; return the maximum difference of the threaded and the serial
+// derivatives, 1 if the two threaded runs differ at all
+double TestRunnable::diff_threads(int nthreads)
+{
+	if (! write_model("diff.mod"))
+		return 1.0;
+	Journal journal("diff.jnl");
+	int max_threads = THREAD_GROUP::max_parallel_threads;
+	THREAD_GROUP::max_parallel_threads = 1;
+	Dynare dser("diff.mod", 3, 1.e-13, journal);
+	THREAD_GROUP::max_parallel_threads = nthreads;
+	Dynare dthr1("diff.mod", 3, 1.e-13, journal);
+	Dynare dthr2("diff.mod", 3, 1.e-13, journal);
+	THREAD_GROUP::max_parallel_threads = max_threads;
+
+	Vector yy((const Vector&)dser.getModel().getInit());
+	yy.mult(1.01);
+	Vector xx(dser.nexog());
+	for (int i = 0; i < xx.length(); i++)
+		xx[i] = 0.01*(i+1);
+	dser.calcDerivatives(yy, xx);
+	dthr1.calcDerivatives(yy, xx);
+	dthr2.calcDerivatives(yy, xx);
+
+	int nser = dser.getModel().getParser().getTree().get_num_op();
+	int nthr1 = dthr1.getModel().getParser().getTree().get_num_op();
+	int nthr2 = dthr2.getModel().getParser().getTree().get_num_op();
+	double err = max_diff(dser.getModelDerivatives(), dthr1.getModelDerivatives());
+	double rerr = max_diff(dthr1.getModelDerivatives(), dthr2.getModelDerivatives());
+	printf("\tterms serial, threaded twice: %d %d %d\n", nser, nthr1, nthr2);
+	printf("\terror of threaded:            %10.6g\n", err);
+	printf("\tdifference of threaded runs:  %10.6g\n", rerr);
+	if (nthr1 != nthr2 || rerr != 0.0)
+		err = 1.0;
+	return err;
+}
+
+// evaluate the model and its derivatives in a point off the steady
+// state with the interpreted and the native code, and with a copy of
+// the native one, and return the maximum difference; if the compiler
+// is given, it is used instead of the default one and the native
+// code is expected to fail and be replaced by the interpreted one
+double TestRunnable::native_eval(const char* cache_dir, const char* cc)
+{
+	if (! write_model("native.mod"))
+		return 1.0;
+	mkdir(cache_dir, 0777);
+
+	Journal journal("native.jnl");
+	Dynare dint("native.mod", 3, 1.e-13, journal);
+	Dynare dnat("native.mod", 3, 1.e-13, journal);
+	if (cc)
+		setenv("CC", cc, 1);
+	dnat.useNativeCode(cache_dir);
+	if (cc)
+		unsetenv("CC");
+	Dynare dcopy(dnat);
+	printf("\tnative code used, in a copy:  %s %s\n",
+		   dnat.usesNativeCode()? "yes" : "no", dcopy.usesNativeCode()? "yes" : "no");
+	if (dnat.usesNativeCode() != (cc == NULL) || dcopy.usesNativeCode() != (cc == NULL))
+		return 1.0;
+
+	Vector yy((const Vector&)dint.getModel().getInit());
+	yy.mult(1.01);
+	Vector xx(dint.nexog());
+	for (int i = 0; i < xx.length(); i++)
+		xx[i] = 0.01*(i+1);
+
+	Vector oint(dint.ny());
+	Vector onat(dint.ny());
+	Vector ocopy(dint.ny());
+	dint.evaluateSystem(oint, yy, xx);
+	dnat.evaluateSystem(onat, yy, xx);
+	dcopy.evaluateSystem(ocopy, yy, xx);
+	double err = std::max(max_diff(oint, onat), max_diff(oint, ocopy));
+	printf("\terror of system:              %10.6g\n", err);
+
+	dint.calcDerivatives(yy, xx);
+	dnat.calcDerivatives(yy, xx);
+	dcopy.calcDerivatives(yy, xx);
+	double derr = std::max(max_diff(dint.getModelDerivatives(), dnat.getModelDerivatives()),
+						   max_diff(dint.getModelDerivatives(), dcopy.getModelDerivatives()));
+	printf("\terror of derivatives:         %10.6g\n", derr);
+	return std::max(err, derr);
+}
+
+class SparseLUSmall : public TestRunnable {
+public:
+	SparseLUSmall()
+		: TestRunnable("sparse LU against dense LU (n=20,nnz/col=3)") {}
+
+	bool run() const
+		{
+			double err = sparse_lu(20, 3, 2);
+			return err < 1.e-10;
+		}
+};
+
+class SparseLULarge : public TestRunnable {
+public:
+	SparseLULarge()
+		: TestRunnable("sparse LU against dense LU (n=400,nnz/col=5)") {}
+
+	bool run() const
+		{
+			double err = sparse_lu(400, 5, 3);
+			return err < 1.e-10;
+		}
+};
+
+class NLSolveSparse : public TestRunnable {
+public:
+	NLSolveSparse()
+		: TestRunnable("non-linear solve with sparse Jacobian (n=300)") {}
+
+	bool run() const
+		{
+			double err = nl_solve(300, 0.2, 0.3);
+			return err < 1.e-10;
+		}
+};
+
+class DiffThreads : public TestRunnable {
+public:
+	DiffThreads()
+		: TestRunnable("threaded against serial differentiation (example1, order=3)") {}
+
+	bool run() const
+		{
+			double err = diff_threads(4);
+			return err < 1.e-12;
+		}
+};
+
+class NativeEval : public TestRunnable {
+public:
+	NativeEval()
+		: TestRunnable("native against interpreted evaluation (example1, order=3)") {}
+
+	bool run() const
+		{
+			double err = native_eval("native_cache", NULL);
+			return err < 1.e-12;
+		}
+};
+
+class NativeEvalFallback : public TestRunnable {
+public:
+	NativeEvalFallback()
+		: TestRunnable("interpreted evaluation if compiler fails (example1, order=3)") {}
+
+	bool run() const
+		{
+			double err = native_eval("native_cache_fail", "false");
+			return err == 0.0;
+		}
+};
+
+int main()
+{
+	TestRunnable* all_tests[50];
+	// fill in vector of all tests
+	int num_tests = 0;
+	all_tests[num_tests++] = new SparseLUSmall();
+	all_tests[num_tests++] = new SparseLULarge();
+	all_tests[num_tests++] = new NLSolveSparse();
+	all_tests[num_tests++] = new DiffThreads();
+	all_tests[num_tests++] = new NativeEval();
+	all_tests[num_tests++] = new NativeEvalFallback();
+
+	// launch the tests
+	int success = 0;
+	for (int i = 0; i < num_tests; i++) {
+		try {
+			if (all_tests[i]->test())
+				success++;
+		} catch (const DynareException& e) {
+			printf("Caught Dynare exception in <%s>:\n", all_tests[i]->getName());
+			printf("%s\n", e.message());
+		} catch (SylvException& e) {
+			printf("Caught Sylv exception in <%s>:\n", all_tests[i]->getName());
+			e.printMessage();
+		} catch (const ogu::Exception& e) {
+			printf("Caught exception in <%s>:\n", all_tests[i]->getName());
+			e.print();
+		}
+	}
+
+	printf("There were %d tests that failed out of %d tests run.\n",
+		   num_tests - success, num_tests);
+
+	// destroy
+	for (int i = 0; i < num_tests; i++) {
+		delete all_tests[i];
+	}
+
+	return 0;
+}
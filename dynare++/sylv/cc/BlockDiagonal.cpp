@@ -162,107 +162,12 @@ int BlockDiagonal::getLargestBlock() const
 }
 
 
-void BlockDiagonal::savePartOfX(int si, int ei, const KronVector& x, Vector& work)
-{
-	for (int i = si; i < ei; i++) {
-		ConstKronVector xi(x, i);
-		Vector target(work, (i-si)*xi.length(), xi.length());
-		target = xi;
-	}
-}
-
-void BlockDiagonal::multKronBlock(const_diag_iter start, const_diag_iter end,
-								  KronVector& x, Vector& work) const
-{
-	int si = (*start).getIndex();
-	int ei = diagonal.getSize();
-	if (end != diag_end())
-		ei = (*end).getIndex();
-	savePartOfX(si, ei, x, work);
-
-	for (const_diag_iter di = start; di != end; ++di) {
-		int jbar = (*di).getIndex();
-		if ((*di).isReal()) {
-			KronVector xi(x, jbar);
-			xi.zeros();
-			Vector wi(work, (jbar-si)*xi.length(), xi.length());
-			xi.add(*((*di).getAlpha()), wi);
-			for (const_row_iter ri = row_begin(*di); ri != row_end(*di); ++ri) {
-				int col = ri.getCol();
-				Vector wj(work, (col-si)*xi.length(), xi.length());
-				xi.add(*ri, wj);
-			}
-		} else {
-			KronVector xi(x, jbar);
-			KronVector xii(x, jbar+1);
-			xi.zeros();
-			xii.zeros();
-			Vector wi(work, (jbar-si)*xi.length(), xi.length());
-			Vector wii(work, (jbar+1-si)*xi.length(), xi.length());
-			xi.add(*((*di).getAlpha()), wi);
-			xi.add((*di).getBeta1(), wii);
-			xii.add((*di).getBeta2(), wi);
-			xii.add(*((*di).getAlpha()), wii);
-			for (const_row_iter ri = row_begin(*di); ri != row_end(*di); ++ri) {
-				int col = ri.getCol();
-				Vector wj(work, (col-si)*xi.length(), xi.length());
-				xi.add(ri.a(), wj);
-				xii.add(ri.b(), wj);
-			}
-		}
-	}
-}
-
-void BlockDiagonal::multKronBlockTrans(const_diag_iter start, const_diag_iter end,
-									   KronVector& x, Vector& work) const
-{
-	int si = (*start).getIndex();
-	int ei = diagonal.getSize();
-	if (end != diag_end())
-		ei = (*end).getIndex();
-	savePartOfX(si, ei, x, work);
-
-	for (const_diag_iter di = start; di != end; ++di) {
-		int jbar = (*di).getIndex();
-		if ((*di).isReal()) {
-			KronVector xi(x, jbar);
-			xi.zeros();
-			Vector wi(work, (jbar-si)*xi.length(), xi.length());
-			xi.add(*((*di).getAlpha()), wi);
-			for (const_col_iter ci = col_begin(*di); ci != col_end(*di); ++ci) {
-				int row = ci.getRow();
-				Vector wj(work, (row-si)*xi.length(), xi.length());
-				xi.add(*ci, wj);
-			}
-		} else {
-			KronVector xi(x, jbar);
-			KronVector xii(x, jbar+1);
-			xi.zeros();
-			xii.zeros();
-			Vector wi(work, (jbar-si)*xi.length(), xi.length());
-			Vector wii(work, (jbar+1-si)*xi.length(), xi.length());
-			xi.add(*((*di).getAlpha()), wi);
-			xi.add((*di).getBeta2(), wii);
-			xii.add((*di).getBeta1(), wi);
-			xii.add(*((*di).getAlpha()), wii);
-			for (const_col_iter ci = col_begin(*di); ci != col_end(*di); ++ci) {
-				int row = ci.getRow();
-				Vector wj(work, (row-si)*xi.length(), xi.length());
-				xi.add(ci.a(), wj);
-				xii.add(ci.b(), wj);
-			}
-		}
-	}
-}
-
 void BlockDiagonal::multKron(KronVector& x) const
 {
-	int largest = getLargestBlock();
-	Vector work(largest*x.getN()*power(x.getM(),x.getDepth()-1));
 	const_diag_iter start = diag_begin();
 	const_diag_iter end = findBlockStart(start);
 	while (start != diag_end()) {
-		multKronBlock(start, end, x, work);
+		multKronRange(start, end, x, false);
 		start = end;
 		end = findBlockStart(start);
 	}
@@ -271,12 +176,10 @@ void BlockDiagonal::multKron(KronVector& x) const
 
 void BlockDiagonal::multKronTrans(KronVector& x) const
 {
-	int largest = getLargestBlock();
-	Vector work(largest*x.getN()*power(x.getM(),x.getDepth()-1));
 	const_diag_iter start = diag_begin();
 	const_diag_iter end = findBlockStart(start);
 	while (start != diag_end()) {
-		multKronBlockTrans(start, end, x, work);
+		multKronRange(start, end, x, true);
 		start = end;
 		end = findBlockStart(start);
 	}
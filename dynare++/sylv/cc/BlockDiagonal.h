@@ -47,11 +47,6 @@ public:
 private:
   void setZerosToRU(diag_iter edge);
   const_diag_iter findBlockStart(const_diag_iter from) const;
-  static void savePartOfX(int si, int ei, const KronVector &x, Vector &work);
-  void multKronBlock(const_diag_iter start, const_diag_iter end,
-                     KronVector &x, Vector &work) const;
-  void multKronBlockTrans(const_diag_iter start, const_diag_iter end,
-                          KronVector &x, Vector &work) const;
 };
 
 #endif /* BLOCK_DIAGONAL_H */
@@ -8,6 +8,8 @@
 #include "TriangularSylvester.h"
 #include "IterativeSylvester.h"
 
+#include <dynlapack.h>
+
 #include <ctime>
 
 GeneralSylvester::GeneralSylvester(int ord, int n, int m, int zero_cols,
@@ -58,14 +60,48 @@ GeneralSylvester::GeneralSylvester(int ord, int n, int m, int zero_cols,
 	init();
 }
 
+GeneralSylvester::GeneralSylvester(int max_ord, int n, int m, int zero_cols,
+								   const double* da, const double* db,
+								   const double* dc, const SylvParams& ps)
+	: pars(ps),
+	  mem_driver(pars, 0, m, n, max_ord), order(max_ord), a(da, n),
+	  b(db, n, n-zero_cols), c(dc, m), d(n, 0),
+	  solved(false)
+{
+	init();
+}
+
+/* Here we calculate the PLU factors of A together with inv(A)*B, the
+ * Schur decomposition of inv(A)*B and the block diagonalization of
+ * C. The right hand sides are not touched here, they are multiplied
+ * by inv(A) using the stored factors, and by |I 0; 0 Q'|, in
+ * solve(). */
 void GeneralSylvester::init()
 {
+	lapack_int rows = a.numRows();
+	lapack_int info;
+	alu = new SqSylvMatrix(a);
+	ipiv = new lapack_int[rows];
+	dgetrf(&rows, &rows, alu->base(), &rows, ipiv, &info);
 	GeneralMatrix ainvb(b);
+	multInvA(ainvb);
+
+	// condition numbers
+	double* const work = new double[4*rows];
+	lapack_int* const iwork = new lapack_int[rows];
+	double norm1 = a.getNorm1();
 	double rcond1;
+	dgecon("1", &rows, alu->base(), &rows, &norm1, &rcond1,
+		   work, iwork, &info);
+	double norminf = a.getNormInf();
 	double rcondinf;
-	a.multInvLeft2(ainvb, d, rcond1, rcondinf);
+	dgecon("I", &rows, alu->base(), &rows, &norminf, &rcondinf,
+		   work, iwork, &info);
+	delete [] iwork;
+	delete [] work;
 	pars.rcondA1 = rcond1;
 	pars.rcondAI = rcondinf;
+
 	bdecomp = new SchurDecompZero(ainvb);
 	cdecomp = new SimilarityDecomp(c.getData().base(), c.numRows(), *(pars.bs_norm));
 	cdecomp->check(pars, c);
@@ -81,25 +117,52 @@ void GeneralSylvester::solve()
 	if (solved)
 		throw SYLV_MES_EXCEPTION("Attempt to run solve() more than once.");
 
+	solve(order, d);
+
+	solved = true;
+}
+
+void GeneralSylvester::solve(int ord, GeneralMatrix& dd)
+{
+	int dcols = power(getM(), ord);
+	if (dd.numRows() != getN() || dd.getLD() != getN() || dd.numCols() % dcols != 0)
+		throw SYLV_MES_EXCEPTION("Wrong dimensions of right hand sides in GeneralSylvester::solve.");
+	if (ord > order)
+		throw SYLV_MES_EXCEPTION("Order of right hand sides exceeds the order of GeneralSylvester.");
+
 	mem_driver.setStackMode(true);
 
 	clock_t start = clock();
-	// multiply d
-	d.multLeftITrans(bdecomp->getQ());
-	d.multRightKron(cdecomp->getQ(), order);
-	// convert to KronVector
-	KronVector dkron(d.getData(), getM(), getN(), order);
-	// solve
-	sylv->solve(pars, dkron);
-	// multiply d back
-	d.multLeftI(bdecomp->getQ());
-	d.multRightKron(cdecomp->getInvQ(), order);
+	// multiply all right hand sides by inv(A) and Q' at once
+	multInvA(dd);
+	SylvMatrix dall(dd, 0, 0, dd.numRows(), dd.numCols());
+	dall.multLeftITrans(bdecomp->getQ());
+	for (int j = 0; j < dd.numCols(); j += dcols) {
+		SylvMatrix dj(dd, 0, j, getN(), dcols);
+		dj.multRightKron(cdecomp->getQ(), ord);
+		// convert to KronVector
+		KronVector dkron(dj.getData(), getM(), getN(), ord);
+		// solve
+		sylv->solve(pars, dkron);
+		// multiply back
+		dj.multRightKron(cdecomp->getInvQ(), ord);
+	}
+	dall.multLeftI(bdecomp->getQ());
 	clock_t end = clock();
 	pars.cpu_time = ((double)(end-start))/CLOCKS_PER_SEC;
 
 	mem_driver.setStackMode(false);
+}
 
-	solved = true;
+void GeneralSylvester::multInvA(GeneralMatrix& m) const
+{
+	lapack_int rows = a.numRows();
+	lapack_int mcols = m.numCols();
+	lapack_int mld = m.getLD();
+	lapack_int info;
+	if (mcols > 0)
+		dgetrs("N", &rows, &mcols, alu->base(), &rows, ipiv,
+			   m.base(), &mld, &info);
 }
 
 void GeneralSylvester::check(const double* ds)
@@ -128,6 +191,8 @@ void GeneralSylvester::check(const double* ds)
 
 GeneralSylvester::~GeneralSylvester()
 {
+	delete alu;
+	delete [] ipiv;
 	delete bdecomp;
 	delete cdecomp;
 	delete sylv;
@@ -10,6 +10,8 @@
 #include "SimilarityDecomp.h"
 #include "SylvesterSolver.h"
 
+#include <dynlapack.h>
+
 class GeneralSylvester
 {
   SylvParams pars;
@@ -20,6 +22,8 @@ class GeneralSylvester
   const SqSylvMatrix c;
   SylvMatrix d;
   bool solved;
+  SqSylvMatrix *alu; /* PLU factors of A */
+  lapack_int *ipiv; /* pivots of the PLU factors */
   SchurDecompZero *bdecomp;
   SimilarityDecomp *cdecomp;
   SylvesterSolver *sylv;
@@ -42,6 +46,11 @@ public:
                    const double *da, const double *db,
                    const double *dc, double *dd,
                    const SylvParams &ps);
+  /* construct only the decompositions, right hand sides of any order
+     up to max_ord are passed to solve(int, GeneralMatrix&) */
+  GeneralSylvester(int max_ord, int n, int m, int zero_cols,
+                   const double *da, const double *db,
+                   const double *dc, const SylvParams &ps);
   virtual
   ~GeneralSylvester();
   int
@@ -70,9 +79,16 @@ public:
     return pars;
   }
   void solve();
+  /* solves the equation of the given order for right hand sides
+     stacked horizontally in dd, which is n x (k*m^ord) with leading
+     dimension n, the solutions overwrite dd; the decompositions are
+     reused, so this can be called any number of times */
+  void solve(int ord, GeneralMatrix &dd);
   void check(const double *ds);
 private:
   void init();
+  /* m = inv(A)*m using the PLU factors */
+  void multInvA(GeneralMatrix &m) const;
 };
 
 #endif /* GENERAL_SYLVESTER_H */
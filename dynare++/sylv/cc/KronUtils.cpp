@@ -8,9 +8,12 @@ void KronUtils::multAtLevel(int level, const QuasiTriangular& t,
 							KronVector& x)
 {
 	if (0 < level && level < x.getDepth()) {
-		for (int i = 0; i < x.getM(); i++) {
-			KronVector xi(x, i);
-			multAtLevel(level, t, xi);
+		int nsub = power(x.getM(), x.getDepth()-level);
+		int len = x.length()/nsub;
+		for (int i = 0; i < nsub; i++) {
+			Vector xv(x, i*len, len);
+			KronVector xi(xv, x.getM(), x.getN(), level);
+			t.multKron(xi);
 		}
 	} else if (0 == level && 0 < x.getDepth()) {
 		GeneralMatrix tmp(x.base(), x.getN(), power(x.getM(),x.getDepth()));
@@ -27,9 +30,12 @@ void KronUtils::multAtLevelTrans(int level, const QuasiTriangular& t,
 								 KronVector& x)
 {
 	if (0 < level && level < x.getDepth()) {
-		for (int i = 0; i < x.getM(); i++) {
-			KronVector xi(x, i);
-			multAtLevelTrans(level, t, xi);
+		int nsub = power(x.getM(), x.getDepth()-level);
+		int len = x.length()/nsub;
+		for (int i = 0; i < nsub; i++) {
+			Vector xv(x, i*len, len);
+			KronVector xi(xv, x.getM(), x.getN(), level);
+			t.multKronTrans(xi);
 		}
 	} else if (0 == level && 0 < x.getDepth()) {
 		GeneralMatrix tmp(x.base(), x.getN(), power(x.getM(),x.getDepth()));
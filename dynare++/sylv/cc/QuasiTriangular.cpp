@@ -626,17 +626,61 @@ QuasiTriangular::multaKronTrans(KronVector& x, const ConstKronVector& b) const
 
 void QuasiTriangular::multKron(KronVector& x) const
 {
-	KronVector b((const KronVector&)x); // make copy
-	x.zeros();
-	multaKron(x, b);
+	multKronRange(diag_begin(), diag_end(), x, false);
 }
 
 void
 QuasiTriangular::multKronTrans(KronVector& x) const
 {
-	KronVector b((const KronVector&)x); // make copy
-	x.zeros();
-	multaKronTrans(x, b);
+	multKronRange(diag_begin(), diag_end(), x, true);
+}
+
+/* Here x is reshaped to id x d matrix X, and we calculate X=X*T' (or
+   X=X*T if trans) for columns of the range in place. The upper
+   triangle goes to dtrmm, the subdiagonal elements of 2x2 blocks are
+   added from columns saved before the call. Only the columns touched
+   by the subdiagonal are copied, not the whole vector. */
+void QuasiTriangular::multKronRange(const_diag_iter start, const_diag_iter end,
+									KronVector& x, bool trans) const
+{
+	int si = (*start).getIndex();
+	int ei = diagonal.getSize();
+	if (end != diag_end())
+		ei = (*end).getIndex();
+	int id = x.getN()*power(x.getM(), x.getDepth()-1);
+
+	int ncompl = 0;
+	for (const_diag_iter di = start; di != end; ++di)
+		if (!(*di).isReal())
+			ncompl++;
+	Vector work(ncompl*id);
+	int k = 0;
+	for (const_diag_iter di = start; di != end; ++di) {
+		if (!(*di).isReal()) {
+			int src = (trans)? (*di).getIndex()+1 : (*di).getIndex();
+			Vector wk(work, k*id, id);
+			wk = ConstVector(x, src*id, id);
+			k++;
+		}
+	}
+
+	blas_int mm = id;
+	blas_int nn = ei - si;
+	blas_int lda = diagonal.getSize();
+	blas_int ldb = id;
+	double one = 1.0;
+	dtrmm("R", "U", (trans)? "N" : "T", "N", &mm, &nn, &one,
+		  getData().base() + si*lda + si, &lda, x.base() + si*id, &ldb);
+
+	k = 0;
+	for (const_diag_iter di = start; di != end; ++di) {
+		if (!(*di).isReal()) {
+			int dst = (trans)? (*di).getIndex() : (*di).getIndex()+1;
+			Vector xk(x, dst*id, id);
+			xk.add((*di).getBeta2(), ConstVector(work, k*id, id));
+			k++;
+		}
+	}
 }
 
 void QuasiTriangular::multLeftOther(GeneralMatrix& a) const
@@ -514,6 +514,10 @@ public:
 protected:
   void setMatrix(double r, const QuasiTriangular &t);
   void addMatrix(double r, const QuasiTriangular &t);
+  /* x = (T\otimes I)x (or T' if trans) restricted to the diagonal
+     blocks from start to end, the rest of T is taken as zero */
+  void multKronRange(const_diag_iter start, const_diag_iter end,
+                     KronVector &x, bool trans) const;
 private:
   void addUnit();
   /* x = x + (T\otimes I)b */
@@ -5,11 +5,16 @@
 #include "SylvMemory.h"
 #include "SylvException.h"
 #include "KronVector.h"
+#include "TriangularSylvester.h"
 
 #if defined(MATLAB_MEX_FILE) || defined(OCTAVE_MEX_FILE)
 # include <dynmex.h>
 #endif
 
+#ifdef HAVE_PTHREAD
+# include <pthread.h>
+#endif
+
 #include <cmath> 
 #include <cstdio>
 #include <cstdlib>
@@ -18,24 +23,42 @@
 /*   SylvMemoryPool                                       */
 /**********************************************************/
 
-SylvMemoryPool memory_pool;
-
 SylvMemoryPool::SylvMemoryPool()
-	: base(0), length(0), allocated(0), stack_mode(false)
+	: base(0), length(0), allocated(0), live(0), stack_mode(false),
+	  release_pending(false), orphan(false)
+{
+#ifdef HAVE_PTHREAD
+	pthread_mutex_init(&mutex, NULL);
+#endif
+}
+
+void SylvMemoryPool::lock()
+{
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&mutex);
+#endif
+}
+
+void SylvMemoryPool::unlock()
 {
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&mutex);
+#endif
 }
 
 void SylvMemoryPool::init(size_t size)
 {
 #ifdef USE_MEMORY_POOL
+	if (base)
+		throw SYLV_MES_EXCEPTION("Attempt to initialize memory pool twice.");
 	length = size;
 
 #if defined(MATLAB_MEX_FILE) || defined(OCTAVE_MEX_FILE)
-	if (base)
-		throw SYLV_MES_EXCEPTION("Attempt to use matlab memory pool twice.");
 	base = (char*) mxMalloc(length);
 #else
 	base = (char*) malloc(length);
+	if (!base)
+		throw SYLV_MES_EXCEPTION("Malloc unable to allocate memory pool.");
 #endif
 
 #else
@@ -44,21 +67,34 @@ void SylvMemoryPool::init(size_t size)
 }
 
 void* SylvMemoryPool::allocate(size_t size)
+{
+	void* res = tryAllocate(size);
+	if (!res)
+		throw SYLV_MES_EXCEPTION("Run out of memory space");
+	return res;
+}
+
+void* SylvMemoryPool::tryAllocate(size_t size)
 {
 #ifdef USE_MEMORY_POOL
-	if (allocated + size < length) {
-		char* res = base + allocated;
+	size = (size + 15) & ~((size_t)15); // keep the blocks aligned
+	char* res = 0;
+	lock();
+	if (base && !release_pending && allocated + size < length) {
+		res = base + allocated;
 		allocated += size;
-		return res;
-	} else {
-		throw SYLV_MES_EXCEPTION("Run out of memory space");
+		live++;
 	}
+	unlock();
+	return res;
 #else
-	throw SYLV_MES_EXCEPTION("SylvMemoryPool::allocate() called for non memory pool code.");
+	throw SYLV_MES_EXCEPTION("SylvMemoryPool::tryAllocate() called for non memory pool code.");
 #endif
 }
 
-void SylvMemoryPool::free(void* p)
+static SylvMemoryPool* find_current_pool();
+
+bool SylvMemoryPool::free(void* p)
 {
 #ifdef USE_MEMORY_POOL
 	int offset = ((char*)p) - base;
@@ -70,8 +106,20 @@ void SylvMemoryPool::free(void* p)
 		throw SYLV_MES_EXCEPTION("SylvMemoryPool::free() frees wrong address > end.");
 #endif	
 
-	if (stack_mode && offset >= 0 && offset < (int)allocated)
+	// only the thread of the pool may give the top of the stack back
+	bool own = (this == find_current_pool());
+	lock();
+	if (live > 0)
+		live--;
+	if (own && stack_mode && offset >= 0 && offset < (int)allocated)
 		allocated = offset;
+	if (live == 0 && release_pending) {
+		freeBase();
+		release_pending = false;
+	}
+	bool destroy = (live == 0 && orphan);
+	unlock();
+	return destroy;
 
 #else
 	throw SYLV_MES_EXCEPTION("SylvMemoryPool::free() called for non memory pool code.");
@@ -80,49 +128,215 @@ void SylvMemoryPool::free(void* p)
 
 void SylvMemoryPool::setStackMode(bool mode)
 {
+	lock();
 	stack_mode = mode;
+	unlock();
+}
+
+void SylvMemoryPool::rewind(size_t mark)
+{
+	lock();
+	if (mark < allocated)
+		allocated = mark;
+	unlock();
 }
 
 SylvMemoryPool::~SylvMemoryPool()
 {
-	reset();
+	freeBase();
+#ifdef HAVE_PTHREAD
+	pthread_mutex_destroy(&mutex);
+#endif
 }
 
-void SylvMemoryPool::reset()
+void SylvMemoryPool::freeBase()
 {
-#if !defined(MATLAB_MEX_FILE) && !defined(OCTAVE_MEX_FILE)
-	delete [] base;
+	if (base) {
+#if defined(MATLAB_MEX_FILE) || defined(OCTAVE_MEX_FILE)
+		mxFree(base);
+#else
+		::free(base);
+#endif
+	}
 	base = 0;
 	allocated = 0;
 	length = 0;
 	stack_mode = false;
-#endif
 }
 
+void SylvMemoryPool::reset()
+{
+	lock();
+	if (live > 0) {
+		unlock();
+		throw SYLV_MES_EXCEPTION("Attempt to reset memory pool with live allocations.");
+	}
+	freeBase();
+	release_pending = false;
+	unlock();
+}
+
+void SylvMemoryPool::release()
+{
+	lock();
+	if (live == 0) {
+		freeBase();
+		release_pending = false;
+	} else {
+		stack_mode = false;
+		release_pending = (base != 0);
+	}
+	unlock();
+}
+
+bool SylvMemoryPool::claim()
+{
+	lock();
+	bool res = (base != 0 && release_pending);
+	release_pending = false;
+	unlock();
+	return res;
+}
+
+bool SylvMemoryPool::abandon()
+{
+	lock();
+	orphan = true;
+	stack_mode = false;
+	bool destroy = (live == 0);
+	unlock();
+	return destroy;
+}
+
+/* The pools live outside of any pool, so they are created by malloc
+   and placement new. With POSIX threads, the pool of a thread is
+   destroyed when the thread exits, or, if some of its blocks are still
+   alive, when the last of them is freed. */
+
+static SylvMemoryPool* new_pool()
+{
+	void* mem = malloc(sizeof(SylvMemoryPool));
+	if (!mem)
+		throw SYLV_MES_EXCEPTION("Malloc unable to allocate memory pool.");
+	return new (mem) SylvMemoryPool();
+}
+
+static void destroy_pool(SylvMemoryPool* pool)
+{
+	pool->~SylvMemoryPool();
+	free(pool);
+}
+
+#ifdef HAVE_PTHREAD
+
+static pthread_key_t pool_key;
+static pthread_once_t pool_key_once = PTHREAD_ONCE_INIT;
+
+extern "C" {
+	static void delete_pool(void* p)
+	{
+		SylvMemoryPool* pool = (SylvMemoryPool*) p;
+		if (pool->abandon())
+			destroy_pool(pool);
+	}
+
+	static void make_pool_key()
+	{
+		pthread_key_create(&pool_key, delete_pool);
+	}
+}
+
+static SylvMemoryPool* find_current_pool()
+{
+	pthread_once(&pool_key_once, make_pool_key);
+	return (SylvMemoryPool*) pthread_getspecific(pool_key);
+}
+
+SylvMemoryPool& SylvMemoryPool::current()
+{
+	SylvMemoryPool* pool = find_current_pool();
+	if (!pool) {
+		pool = new_pool();
+		pthread_setspecific(pool_key, pool);
+	}
+	return *pool;
+}
+
+#else
+
+static SylvMemoryPool* the_pool = 0;
+
+static SylvMemoryPool* find_current_pool()
+{
+	return the_pool;
+}
+
+SylvMemoryPool& SylvMemoryPool::current()
+{
+	if (!the_pool)
+		the_pool = new_pool();
+	return *the_pool;
+}
+
+#endif
+
 /**********************************************************/
 /*   global new and delete                                */
 /**********************************************************/
 
 #ifdef USE_MEMORY_POOL
 
+/* Each block is preceded by a header with the pool it was taken from,
+   or 0 if it was malloc-ed. The header keeps the blocks aligned. */
+
+static const size_t block_header = 16;
+
+static void* pool_allocate(size_t size)
+{
+	SylvMemoryPool* pool = find_current_pool();
+	char* res = 0;
+	if (pool && pool->isStackMode())
+		res = (char*) pool->tryAllocate(size + block_header);
+	if (!res) {
+		pool = 0;
+		res = (char*) malloc(size + block_header);
+		if (!res)
+			throw SYLV_MES_EXCEPTION("Malloc unable to allocate memory.");
+	}
+	*((SylvMemoryPool**) res) = pool;
+	return res + block_header;
+}
+
+static void pool_free(void* p)
+{
+	if (!p)
+		return;
+	char* block = ((char*) p) - block_header;
+	SylvMemoryPool* pool = *((SylvMemoryPool**) block);
+	if (!pool)
+		free(block);
+	else if (pool->free(block))
+		destroy_pool(pool);
+}
+
 void* operator new(size_t size)
 {
-	return memory_pool.allocate(size);
+	return pool_allocate(size);
 }
 
 void* operator new[](size_t size)
 {
-	return memory_pool.allocate(size);
+	return pool_allocate(size);
 }
 
 void operator delete(void* p)
 {
-	memory_pool.free(p);
+	pool_free(p);
 }
 
 void operator delete[](void* p)
 {
-	memory_pool.free(p);
+	pool_free(p);
 }
 
 #endif
@@ -184,25 +398,38 @@ void MallocAllocator::operator delete[](void* p)
 void SylvMemoryDriver::allocate(int num_d, int m, int n, int order)
 {
 #ifdef USE_MEMORY_POOL
+	if (pool.claim()) {
+		owner = true;
+		mark = pool.getMark();
+		return;
+	}
+	if (pool.isInitialized()) {
+		mark = pool.getMark();
+		return;
+	}
 	int x_cols = power(m,order);
 	int total = num_d*x_cols*n; // storage for big matrices
 	total += x_cols; // storage for one extra row of a big matrix
 	int dig_vectors = (int)ceil(((double)(power(m,order)-1))/(m-1));
 	total += 8*n*dig_vectors; // storage for kron vectors instantiated during solv
+	total += 2*(TriangularSylvester::getPanelWidth()+1)*n*dig_vectors; // panels of TriangularSylvester
 	total += 50*(m*m+n*n); // some storage for small square matrices
 	total *= sizeof(double); // everything in doubles
-	memory_pool.init(total);
+	pool.init(total);
+	owner = true;
 #endif
 }
 
 
 SylvMemoryDriver::SylvMemoryDriver(int num_d, int m, int n, int order)
+	: pool(SylvMemoryPool::current()), owner(false), mark(0)
 {
 	allocate(num_d, m, n, order);
 }
 
 SylvMemoryDriver::SylvMemoryDriver(const SylvParams& pars, int num_d,
 								   int m, int n, int order)
+	: pool(SylvMemoryPool::current()), owner(false), mark(0)
 {
 	if (*(pars.method) == SylvParams::iter)
 		num_d++;
@@ -213,9 +440,12 @@ SylvMemoryDriver::SylvMemoryDriver(const SylvParams& pars, int num_d,
 
 SylvMemoryDriver::~SylvMemoryDriver()
 {
-	memory_pool.reset();
+	if (owner)
+		pool.release();
+	else if (pool.isInitialized())
+		pool.rewind(mark);
 }
 
 void SylvMemoryDriver::setStackMode(bool mode) {
-	memory_pool.setStackMode(mode);
+	SylvMemoryPool::current().setStackMode(mode);
 }
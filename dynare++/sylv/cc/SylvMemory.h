@@ -9,6 +9,10 @@
 
 #include <new>
 
+#ifdef HAVE_PTHREAD
+# include <pthread.h>
+#endif
+
 class MallocAllocator
 {
 #ifdef USE_MEMORY_POOL
@@ -27,12 +31,28 @@ void operator delete(void *p);
 void operator delete[](void *p);
 #endif
 
+/* Every thread has its own pool, returned by SylvMemoryPool::current(),
+   so several Sylvester equations can be solved in parallel. The pool
+   of a thread is initialized by the first SylvMemoryDriver created in
+   the thread and released by its destructor, drivers created while the
+   pool is in use only rewind it to where they found it. The global new
+   takes memory from the pool only while the pool of the thread is in
+   stack mode, otherwise, or if the pool is full, it falls back to
+   malloc. A block remembers its pool, so it can be deleted in any
+   thread, and a pool with live blocks is released only after its last
+   block is deleted. */
 class SylvMemoryPool
 {
   char *base;
   size_t length;
   size_t allocated;
+  size_t live;
   bool stack_mode;
+  bool release_pending;
+  bool orphan;
+#ifdef HAVE_PTHREAD
+  pthread_mutex_t mutex;
+#endif
   SylvMemoryPool(const SylvMemoryPool &);
   const SylvMemoryPool &operator=(const SylvMemoryPool &);
 public:
@@ -40,18 +60,65 @@ public:
   ~SylvMemoryPool();
   void init(size_t size);
   void *allocate(size_t size);
-  void free(void *p);
+  /* as allocate(), but returns 0 if the pool is full */
+  void *tryAllocate(size_t size);
+  /* returns true if the pool was abandoned and this was its last block */
+  bool free(void *p);
+  /* throws if some blocks are still alive */
   void reset();
+  /* resets now or, if some blocks are alive, after the last is freed */
+  void release();
+  /* cancels a pending release, returns true if there was one */
+  bool claim();
+  /* called when the thread of the pool exits, returns true if the pool
+     can be destroyed now, otherwise it is left to the last free() */
+  bool abandon();
   void setStackMode(bool);
+  bool
+  isInitialized() const
+  {
+    return base != 0;
+  }
+  bool
+  isStackMode() const
+  {
+    return stack_mode && base != 0;
+  }
+  bool
+  contains(const void *p) const
+  {
+    return base <= (const char *) p && (const char *) p < base + length;
+  }
+  size_t
+  getMark() const
+  {
+    return allocated;
+  }
+  size_t
+  getNumLive() const
+  {
+    return live;
+  }
+  void rewind(size_t mark);
+  /* pool of the calling thread */
+  static SylvMemoryPool &current();
+private:
+  void lock();
+  void unlock();
+  void freeBase();
 };
 
 class SylvMemoryDriver
 {
+  SylvMemoryPool &pool;
+  bool owner;
+  size_t mark;
   SylvMemoryDriver(const SylvMemoryDriver &);
   const SylvMemoryDriver &operator=(const SylvMemoryDriver &);
 public:
   SylvMemoryDriver(int num_d, int m, int n, int order);
   SylvMemoryDriver(const SylvParams &pars, int num_d, int m, int n, int order);
+  /* sets the stack mode of the pool of the calling thread */
   static void setStackMode(bool);
   ~SylvMemoryDriver();
 protected:
@@ -6,12 +6,21 @@
 #include "QuasiTriangularZero.h"
 #include "KronUtils.h"
 #include "BlockDiagonal.h"
+#include "SylvException.h"
 
 #include <cstdio>
 #include <cmath>
 
 double TriangularSylvester::diag_zero = 1.e-15;
 double TriangularSylvester::diag_zero_sq = 1.e-30;
+int TriangularSylvester::panel_width = 16;
+
+void TriangularSylvester::setPanelWidth(int pw)
+{
+	if (pw < 1)
+		throw SYLV_MES_EXCEPTION("Panel width of TriangularSylvester must be at least one.");
+	panel_width = pw;
+}
 
 TriangularSylvester::TriangularSylvester(const QuasiTriangular& k,
 										 const QuasiTriangular& f)
@@ -65,18 +74,72 @@ void TriangularSylvester::solvi(double r, KronVector& d, double& eig_min) const
 		t->solvePre(d, eig_min);
 		delete t;
 	} else {
-		for (const_diag_iter di = matrixF->diag_begin();
-			 di != matrixF->diag_end();
-			 ++di) {
-			if ((*di).isReal()) {
-				solviRealAndEliminate(r, di, d, eig_min);
-			} else {
-				solviComplexAndEliminate(r, di, d, eig_min);
+		const_diag_iter di = matrixF->diag_begin();
+		while (di != matrixF->diag_end()) {
+			const_diag_iter dbeg = di;
+			const_diag_iter dend = panelEnd(di);
+			int pbeg = (*di).getIndex();
+			int pend = panelColumn(dend);
+			GeneralMatrix y(d.length()/d.getM(), pend-pbeg);
+			for (; di != dend; ++di) {
+				if ((*di).isReal()) {
+					solviRealAndEliminate(r, di, pbeg, pend, d, y, eig_min);
+				} else {
+					solviComplexAndEliminate(r, di, pbeg, pend, d, y, eig_min);
+				}
 			}
+			eliminatePanel(*matrixF, dbeg, dend, d, y);
 		}
 	}
 }
 
+/* returns the first diagonal block of the panel starting at di */
+TriangularSylvester::const_diag_iter
+TriangularSylvester::panelEnd(const_diag_iter di) const
+{
+	int pbeg = (*di).getIndex();
+	while (di != matrixF->diag_end() && (*di).getIndex() - pbeg < panel_width)
+		++di;
+	return di;
+}
+
+/* returns the first column of the given diagonal block, or the
+ * dimension of F for the end */
+int TriangularSylvester::panelColumn(const_diag_iter di) const
+{
+	if (di == matrixF->diag_end())
+		return matrixF->numRows();
+	return (*di).getIndex();
+}
+
+/* Subtracts contribution of the panel [dbeg,dend) from all columns of
+ * d right to the panel. If d is viewed as a matrix whose columns are
+ * the KronVectors of lower depth, this is D_2 = D_2 - Y*F_12, where
+ * F_12 is the part of f in the panel rows and right to the panel. The
+ * columns beyond the longest row of the panel (which matters for
+ * BlockDiagonal) are not touched. */
+void TriangularSylvester::eliminatePanel(const QuasiTriangular& f,
+										 const_diag_iter dbeg, const_diag_iter dend,
+										 KronVector& d, const GeneralMatrix& y)
+{
+	int pbeg = (*dbeg).getIndex();
+	int pend = pbeg + y.numCols();
+	int cend = pend;
+	for (const_diag_iter di = dbeg; di != dend; ++di) {
+		int col = f.row_end(*di).getCol();
+		if (col > cend)
+			cend = col;
+	}
+	if (cend == pend)
+		return;
+
+	GeneralMatrix dmat(d.base(), y.numRows(), d.getM());
+	GeneralMatrix dtrail(dmat, 0, pend, y.numRows(), cend-pend);
+	dtrail.multAndAdd(ConstGeneralMatrix(y),
+					  ConstGeneralMatrix(f, pbeg, pend, pend-pbeg, cend-pend),
+					  -1.0);
+}
+
 
 void TriangularSylvester::solvii(double alpha, double beta1, double beta2,
 								 KronVector& d1, KronVector& d2,
@@ -108,19 +171,33 @@ void TriangularSylvester::solviip(double alpha, double betas,
 	} else {
 		const_diag_iter di = matrixF->diag_begin();
 		const_diag_iter dsi = matrixFF->diag_begin();
-		for (; di != matrixF->diag_end(); ++di, ++dsi) {
-			if ((*di).isReal()) {
-				solviipRealAndEliminate(alpha, betas, di, dsi, d, eig_min);
-			} else {
-				solviipComplexAndEliminate(alpha, betas, di, dsi, d, eig_min);
+		while (di != matrixF->diag_end()) {
+			const_diag_iter dbeg = di;
+			const_diag_iter dsbeg = dsi;
+			const_diag_iter dend = panelEnd(di);
+			int pbeg = (*di).getIndex();
+			int pend = panelColumn(dend);
+			GeneralMatrix y1(d.length()/d.getM(), pend-pbeg);
+			GeneralMatrix y2(d.length()/d.getM(), pend-pbeg);
+			for (; di != dend; ++di, ++dsi) {
+				if ((*di).isReal()) {
+					solviipRealAndEliminate(alpha, betas, di, dsi, pbeg, pend,
+											d, y1, y2, eig_min);
+				} else {
+					solviipComplexAndEliminate(alpha, betas, di, dsi, pbeg, pend,
+											   d, y1, y2, eig_min);
+				}
 			}
+			eliminatePanel(*matrixF, dbeg, dend, d, y1);
+			eliminatePanel(*matrixFF, dsbeg, dsi, d, y2);
 		}
 	}
 }
 
 
 void TriangularSylvester::solviRealAndEliminate(double r, const_diag_iter di,
-												KronVector& d, double& eig_min) const
+												int pbeg, int pend, KronVector& d,
+												GeneralMatrix& y, double& eig_min) const
 {
 	// di is real
 	int jbar = (*di).getIndex();
@@ -130,19 +207,21 @@ void TriangularSylvester::solviRealAndEliminate(double r, const_diag_iter di,
 	if (abs(r*f) > diag_zero) { 
 		solvi(r*f, dj, eig_min);
 	}
-	// calculate y
-	KronVector y((const KronVector&)dj);
-	KronUtils::multKron(*matrixF, *matrixK, y);
-	y.mult(r);
+	// calculate y to the panel
+	Vector ycol(y, jbar-pbeg);
+	KronVector yj(ycol, d.getM(), d.getN(), d.getDepth()-1);
+	yj = dj;
+	KronUtils::multKron(*matrixF, *matrixK, yj);
+	yj.mult(r);
 	double divisor = 1.0;
-	solviEliminateReal(di, d, y, divisor);
+	solviEliminateReal(di, pend, d, yj, divisor);
 }
 
-void TriangularSylvester::solviEliminateReal(const_diag_iter di, KronVector& d,
+void TriangularSylvester::solviEliminateReal(const_diag_iter di, int pend, KronVector& d,
 											 const KronVector& y, double divisor) const
 {
 	for (const_row_iter ri = matrixF->row_begin(*di);
-		 ri != matrixF->row_end(*di);
+		 ri != matrixF->row_end(*di) && ri.getCol() < pend;
 		 ++ri) {
 		KronVector dk(d, ri.getCol());
 		dk.add(-(*ri)/divisor, y);
@@ -150,7 +229,8 @@ void TriangularSylvester::solviEliminateReal(const_diag_iter di, KronVector& d,
 }
 
 void TriangularSylvester::solviComplexAndEliminate(double r, const_diag_iter di,
-												   KronVector& d, double& eig_min) const
+												   int pbeg, int pend, KronVector& d,
+												   GeneralMatrix& y, double& eig_min) const
 {
 	// di is complex
 	int jbar = (*di).getIndex();
@@ -165,22 +245,26 @@ void TriangularSylvester::solviComplexAndEliminate(double r, const_diag_iter di,
 	if (r*r*aspbs > diag_zero_sq) { 
 		solvii(r*alpha, r*beta1, r*beta2, dj, djj, eig_min);
 	}
-	KronVector y1(dj);
-	KronVector y2(djj);
+	Vector y1col(y, jbar-pbeg);
+	Vector y2col(y, jbar+1-pbeg);
+	KronVector y1(y1col, d.getM(), d.getN(), d.getDepth()-1);
+	KronVector y2(y2col, d.getM(), d.getN(), d.getDepth()-1);
+	y1 = dj;
+	y2 = djj;
 	KronUtils::multKron(*matrixF, *matrixK, y1);
 	KronUtils::multKron(*matrixF, *matrixK, y2);
 	y1.mult(r);
 	y2.mult(r);
 	double divisor = 1.0;
-	solviEliminateComplex(di, d, y1, y2, divisor);
+	solviEliminateComplex(di, pend, d, y1, y2, divisor);
 }
 
-void TriangularSylvester::solviEliminateComplex(const_diag_iter di, KronVector& d,
+void TriangularSylvester::solviEliminateComplex(const_diag_iter di, int pend, KronVector& d,
 												const KronVector& y1, const KronVector& y2,
 												double divisor) const
 {
 	for (const_row_iter ri = matrixF->row_begin(*di);
-		 ri != matrixF->row_end(*di);
+		 ri != matrixF->row_end(*di) && ri.getCol() < pend;
 		 ++ri) {
 		KronVector dk(d, ri.getCol());
 		dk.add(-ri.a()/divisor, y1);
@@ -190,7 +274,9 @@ void TriangularSylvester::solviEliminateComplex(const_diag_iter di, KronVector&
 
 void TriangularSylvester::solviipRealAndEliminate(double alpha, double betas,
 												  const_diag_iter di, const_diag_iter dsi,
-												  KronVector& d, double& eig_min) const
+												  int pbeg, int pend, KronVector& d,
+												  GeneralMatrix& y1, GeneralMatrix& y2,
+												  double& eig_min) const
 {
 	// di, and dsi are real		
 	int jbar = (*di).getIndex();
@@ -203,25 +289,29 @@ void TriangularSylvester::solviipRealAndEliminate(double alpha, double betas,
 	if (fs*aspbs > diag_zero_sq) {
 		solviip(f*alpha, fs*betas, dj, eig_min);
 	}
-	KronVector y1((const KronVector&)dj);
-	KronVector y2((const KronVector&)dj);
-	KronUtils::multKron(*matrixF, *matrixK, y1);
-	y1.mult(2*alpha);
-	KronUtils::multKron(*matrixFF, *matrixKK, y2);
-	y2.mult(aspbs);
+	Vector y1col(y1, jbar-pbeg);
+	Vector y2col(y2, jbar-pbeg);
+	KronVector y1j(y1col, d.getM(), d.getN(), d.getDepth()-1);
+	KronVector y2j(y2col, d.getM(), d.getN(), d.getDepth()-1);
+	y1j = dj;
+	y2j = dj;
+	KronUtils::multKron(*matrixF, *matrixK, y1j);
+	y1j.mult(2*alpha);
+	KronUtils::multKron(*matrixFF, *matrixKK, y2j);
+	y2j.mult(aspbs);
 	double divisor = 1.0;
 	double divisor2 = 1.0;
-	solviipEliminateReal(di, dsi, d, y1, y2, divisor, divisor2);
+	solviipEliminateReal(di, dsi, pend, d, y1j, y2j, divisor, divisor2);
 }
 
 void TriangularSylvester::solviipEliminateReal(const_diag_iter di, const_diag_iter dsi,
-											   KronVector& d,
+											   int pend, KronVector& d,
 											   const KronVector& y1, const KronVector& y2,
 											   double divisor, double divisor2) const
 {
 	const_row_iter ri = matrixF->row_begin(*di);
 	const_row_iter rsi = matrixFF->row_begin(*dsi);
-	for (; ri != matrixF->row_end(*di); ++ri, ++rsi) {
+	for (; ri != matrixF->row_end(*di) && ri.getCol() < pend; ++ri, ++rsi) {
 		KronVector dk(d, ri.getCol());
 		dk.add(-(*ri)/divisor, y1);
 		dk.add(-(*rsi)/divisor2, y2);
@@ -230,7 +320,9 @@ void TriangularSylvester::solviipEliminateReal(const_diag_iter di, const_diag_it
 
 void TriangularSylvester::solviipComplexAndEliminate(double alpha, double betas,
 													 const_diag_iter di, const_diag_iter dsi,
-													 KronVector& d, double& eig_min) const
+													 int pbeg, int pend, KronVector& d,
+													 GeneralMatrix& y1, GeneralMatrix& y2,
+													 double& eig_min) const
 {
 	// di, and dsi are complex
 	int jbar = (*di).getIndex();
@@ -245,26 +337,34 @@ void TriangularSylvester::solviipComplexAndEliminate(double alpha, double betas,
 	if (gspds*aspbs > diag_zero_sq) {
 		solviipComplex(alpha, betas, gamma, delta1, delta2, dj, djj, eig_min);
 	}
-	// here dj, djj is solution, set y1, y2, y11, y22
+	// here dj, djj is solution, set y1, y2, y11, y22 to the panels
+	Vector y1col(y1, jbar-pbeg);
+	Vector y11col(y1, jbar+1-pbeg);
+	Vector y2col(y2, jbar-pbeg);
+	Vector y22col(y2, jbar+1-pbeg);
 	// y1
-	KronVector y1((const KronVector&) dj);
-	KronUtils::multKron(*matrixF, *matrixK, y1);
-	y1.mult(2*alpha);
+	KronVector y1j(y1col, d.getM(), d.getN(), d.getDepth()-1);
+	y1j = dj;
+	KronUtils::multKron(*matrixF, *matrixK, y1j);
+	y1j.mult(2*alpha);
 	// y11
-	KronVector y11((const KronVector&) djj);
-	KronUtils::multKron(*matrixF, *matrixK, y11);
-	y11.mult(2*alpha);
+	KronVector y11j(y11col, d.getM(), d.getN(), d.getDepth()-1);
+	y11j = djj;
+	KronUtils::multKron(*matrixF, *matrixK, y11j);
+	y11j.mult(2*alpha);
 	// y2
-	KronVector y2((const KronVector&) dj);
-	KronUtils::multKron(*matrixFF, *matrixKK, y2);
-	y2.mult(aspbs);
+	KronVector y2j(y2col, d.getM(), d.getN(), d.getDepth()-1);
+	y2j = dj;
+	KronUtils::multKron(*matrixFF, *matrixKK, y2j);
+	y2j.mult(aspbs);
 	// y22
-	KronVector y22((const KronVector&) djj);
-	KronUtils::multKron(*matrixFF, *matrixKK, y22);
-	y22.mult(aspbs);
+	KronVector y22j(y22col, d.getM(), d.getN(), d.getDepth()-1);
+	y22j = djj;
+	KronUtils::multKron(*matrixFF, *matrixKK, y22j);
+	y22j.mult(aspbs);
 
 	double divisor = 1.0;
-	solviipEliminateComplex(di, dsi, d, y1, y11, y2, y22, divisor);
+	solviipEliminateComplex(di, dsi, pend, d, y1j, y11j, y2j, y22j, divisor);
 }
 
 
@@ -290,14 +390,14 @@ void TriangularSylvester::solviipComplex(double alpha, double betas, double gamm
 }
 
 void TriangularSylvester::solviipEliminateComplex(const_diag_iter di, const_diag_iter dsi,
-												  KronVector& d,
+												  int pend, KronVector& d,
 												  const KronVector& y1, const KronVector& y11,
 												  const KronVector& y2, const KronVector& y22,
 												  double divisor) const
 {
 	const_row_iter ri = matrixF->row_begin(*di);
 	const_row_iter rsi = matrixFF->row_begin(*dsi);
-	for (; ri != matrixF->row_end(*di); ++ri, ++rsi) {
+	for (; ri != matrixF->row_end(*di) && ri.getCol() < pend; ++ri, ++rsi) {
 		KronVector dk(d, ri.getCol());
 		dk.add(-ri.a()/divisor, y1);
 		dk.add(-ri.b()/divisor, y11);
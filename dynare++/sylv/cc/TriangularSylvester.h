@@ -78,30 +78,43 @@ private:
   /* auxiliary typedefs */
   typedef QuasiTriangular::const_diag_iter const_diag_iter;
   typedef QuasiTriangular::const_row_iter const_row_iter;
+  /* panels: the diagonal of F is traversed in panels of about
+     panel_width columns; within a panel the eliminations are done
+     column by column, the columns right to the panel are updated at
+     once by one matrix-matrix multiplication */
+  const_diag_iter panelEnd(const_diag_iter di) const;
+  int panelColumn(const_diag_iter di) const;
+  static void eliminatePanel(const QuasiTriangular &f,
+                             const_diag_iter dbeg, const_diag_iter dend,
+                             KronVector &d, const GeneralMatrix &y);
   /* called from solvi */
-  void solviRealAndEliminate(double r, const_diag_iter di,
-                             KronVector &d, double &eig_min) const;
-  void solviComplexAndEliminate(double r, const_diag_iter di,
-                                KronVector &d, double &eig_min) const;
+  void solviRealAndEliminate(double r, const_diag_iter di, int pbeg, int pend,
+                             KronVector &d, GeneralMatrix &y, double &eig_min) const;
+  void solviComplexAndEliminate(double r, const_diag_iter di, int pbeg, int pend,
+                                KronVector &d, GeneralMatrix &y, double &eig_min) const;
   /* called from solviip */
   void solviipRealAndEliminate(double alpha, double betas,
                                const_diag_iter di, const_diag_iter dsi,
-                               KronVector &d, double &eig_min) const;
+                               int pbeg, int pend, KronVector &d,
+                               GeneralMatrix &y1, GeneralMatrix &y2,
+                               double &eig_min) const;
   void solviipComplexAndEliminate(double alpha, double betas,
                                   const_diag_iter di, const_diag_iter dsi,
-                                  KronVector &d, double &eig_min) const;
-  /* eliminations */
-  void solviEliminateReal(const_diag_iter di, KronVector &d,
+                                  int pbeg, int pend, KronVector &d,
+                                  GeneralMatrix &y1, GeneralMatrix &y2,
+                                  double &eig_min) const;
+  /* eliminations within a panel ending at column pend */
+  void solviEliminateReal(const_diag_iter di, int pend, KronVector &d,
                           const KronVector &y, double divisor) const;
-  void solviEliminateComplex(const_diag_iter di, KronVector &d,
+  void solviEliminateComplex(const_diag_iter di, int pend, KronVector &d,
                              const KronVector &y1, const KronVector &y2,
                              double divisor) const;
   void solviipEliminateReal(const_diag_iter di, const_diag_iter dsi,
-                            KronVector &d,
+                            int pend, KronVector &d,
                             const KronVector &y1, const KronVector &y2,
                             double divisor, double divisor2) const;
   void solviipEliminateComplex(const_diag_iter di, const_diag_iter dsi,
-                               KronVector &d,
+                               int pend, KronVector &d,
                                const KronVector &y1, const KronVector &y11,
                                const KronVector &y2, const KronVector &y22,
                                double divisor) const;
@@ -113,6 +126,17 @@ private:
   /* norms for what we consider zero on diagonal of F */
   static double diag_zero;
   static double diag_zero_sq; // square of diag_zero
+  /* number of columns of F in one panel */
+  static int panel_width;
+public:
+  static int
+  getPanelWidth()
+  {
+    return panel_width;
+  }
+  /* sets the number of columns of F in one panel, it must be at least
+     one; it must not be changed while an equation is being solved */
+  static void setPanelWidth(int pw);
 };
 
 #endif /* TRIANGULAR_SYLVESTER_H */
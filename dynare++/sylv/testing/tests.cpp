@@ -5,6 +5,7 @@
 #include "SylvException.h"
 #include "QuasiTriangular.h"
 #include "QuasiTriangularZero.h"
+#include "BlockDiagonal.h"
 #include "Vector.h"
 #include "KronVector.h"
 #include "KronUtils.h"
@@ -24,6 +25,10 @@
 
 #include <cmath>
 
+#ifdef HAVE_PTHREAD
+# include <pthread.h>
+#endif
+
 class TestRunnable : public MallocAllocator {
 	char name[100];
 	static double eps_norm;
@@ -37,6 +42,8 @@ protected:
 	static bool quasi_solve(bool trans, const char* mname, const char* vname);
 	static bool mult_kron(bool trans, const char* mname, const char* vname,
 						  const char* cname, int m, int n, int depth);
+	static bool block_kron(bool trans, const char* mname, const char* vname,
+						   int m, int n, int depth);
 	static bool level_kron(bool trans, const char* mname, const char* vname,
 						   const char* cname, int level, int m, int n, int depth);
 	static bool kron_power(const char* m1name, const char* m2name, const char* vname,
@@ -52,6 +59,8 @@ protected:
 						 int m, int n, int depth);
 	static bool gen_sylv(const char* aname, const char* bname, const char* cname,
 						 const char* dname, int m, int n, int order);
+	static bool gen_sylv_multi(const char* aname, const char* bname, const char* cname,
+							   const char* dname, int m, int n, int order, int nrhs);
 	static bool eig_bubble(const char* aname, int from, int to);
 	static bool block_diag(const char* aname, double log10norm = 3.0);
 	static bool iter_sylv(const char* m1name, const char* m2name, const char* vname,
@@ -152,6 +161,46 @@ bool TestRunnable::mult_kron(bool trans, const char* mname, const char* vname,
 	return (norm < eps_norm);
 }
 
+bool TestRunnable::block_kron(bool trans, const char* mname, const char* vname,
+							  int m, int n, int depth)
+{
+	MMMatrixIn mmt(mname);
+	MMMatrixIn mmv(vname);
+
+	int length = power(m,depth)*n;
+	if (mmt.row() != m ||
+		mmv.row() != length) {
+		printf("  Incompatible sizes for block kron mult action, len=%d, matrow=%d, m=%d, vrow=%d\n",length,mmt.row(), m, mmv.row());
+		return false;
+	}
+
+	SylvMemoryDriver memdriver(1, m, n, depth);
+	QuasiTriangular t(mmt.getData(), mmt.row());
+	BlockDiagonal b(t);
+	// cut the matrix to two diagonal blocks in the middle
+	BlockDiagonal::diag_iter edge = b.diag_begin();
+	while (edge != b.diag_end() && (*edge).getIndex() < m/2)
+		++edge;
+	if (edge != b.diag_end())
+		b.setZeroBlockEdge(edge);
+	QuasiTriangular tb(b.getData().base(), m);
+
+	Vector vraw(mmv.getData(), mmv.row());
+	KronVector v(vraw, m, n, depth);
+	KronVector c((const KronVector&)v);
+	if (trans) {
+		b.multKronTrans(v);
+		tb.multKronTrans(c);
+	} else {
+		b.multKron(v);
+		tb.multKron(c);
+	}
+	c.add(-1.0, v);
+	double norm = c.getNorm();
+	printf("\terror norm = %8.4g\n",norm);
+	return (norm < eps_norm);
+}
+
 bool TestRunnable::level_kron(bool trans, const char* mname, const char* vname,
 							  const char* cname, int level, int m, int n, int depth)
 {
@@ -377,6 +426,56 @@ bool TestRunnable::gen_sylv(const char* aname, const char* bname, const char* cn
 			*(pars.vec_errI) < eps_norm);
 }
 
+bool TestRunnable::gen_sylv_multi(const char* aname, const char* bname, const char* cname,
+								  const char* dname, int m, int n, int order, int nrhs)
+{
+	MMMatrixIn mma(aname);
+	MMMatrixIn mmb(bname);
+	MMMatrixIn mmc(cname);
+	MMMatrixIn mmd(dname);
+
+	if (m != mmc.row() || m != mmc.col() ||
+		n != mma.row() || n != mma.col() ||
+		n != mmb.row() || n <  mmb.col() ||
+		n != mmd.row() || power(m, order) != mmd.col()) {
+		printf("  Incompatible sizes for gen_sylv_multi.\n");
+		return false;
+	}
+
+	SylvParams ps;
+	GeneralSylvester gs(order, n, m, n-mmb.col(),
+						mma.getData(), mmb.getData(),
+						mmc.getData(), mmd.getData(),
+						ps);
+	gs.solve();
+
+	// factor once, solve nrhs copies of the right hand side twice
+	GeneralSylvester gsm(order, n, m, n-mmb.col(),
+						 mma.getData(), mmb.getData(),
+						 mmc.getData(), ps);
+	int dcols = mmd.col();
+	ConstGeneralMatrix dorig(mmd.getData(), n, dcols);
+	ConstGeneralMatrix x(gs.getResult(), n, dcols);
+	double maxdiff = 0.0;
+	for (int rep = 0; rep < 2; rep++) {
+		GeneralMatrix dd(n, nrhs*dcols);
+		for (int j = 0; j < nrhs; j++)
+			dd.place(dorig, 0, j*dcols);
+		gsm.solve(order, dd);
+		for (int j = 0; j < nrhs; j++) {
+			GeneralMatrix xj(dd, 0, j*dcols, n, dcols);
+			xj.add(-1.0, x);
+			double diff = xj.getNormInf();
+			if (diff > maxdiff)
+				maxdiff = diff;
+		}
+	}
+	double xnorm = x.getNormInf();
+	printf("\tmax difference to single solve: %8.4g (norm of solution %8.4g)\n",
+		   maxdiff, xnorm);
+	return (maxdiff < eps_norm*xnorm);
+}
+
 bool TestRunnable::eig_bubble(const char* aname, int from, int to)
 {
 	MMMatrixIn mma(aname);
@@ -572,6 +671,18 @@ public:
 	bool run() const;
 };
 
+class BlockKronTest : public TestRunnable {
+public:
+	BlockKronTest() : TestRunnable("block diagonal kronecker mult (245=7x7x5)") {}
+	bool run() const;
+};
+
+class BlockKronTransTest : public TestRunnable {
+public:
+	BlockKronTransTest() : TestRunnable("block diagonal kronecker trans mult (245=7x7x5)") {}
+	bool run() const;
+};
+
 class LevelKronTest : public TestRunnable {
 public:
 	LevelKronTest() : TestRunnable("kronecker level mult (1715=7x[7]x7x5)") {}
@@ -656,6 +767,12 @@ public:
 	bool run() const;
 };
 
+class TriSylvPanelTest : public TestRunnable {
+public:
+	TriSylvPanelTest() : TestRunnable("triangular sylvester narrow panel solve (48000=40x40x30)") {}
+	bool run() const;
+};
+
 class IterSylvTest : public TestRunnable {
 public:
 	IterSylvTest() : TestRunnable("iterative sylvester solve (245=7x7x5)") {}
@@ -680,6 +797,12 @@ public:
 	bool run() const;
 };
 
+class GenSylvMultiTest : public TestRunnable {
+public:
+	GenSylvMultiTest() : TestRunnable("general sylvester factored once (3x12000=3x20x20x30)") {}
+	bool run() const;
+};
+
 class GenSylvSingTest : public TestRunnable {
 public:
 	GenSylvSingTest() : TestRunnable("general sylvester solve for sing. C (2500000=50x50x50x20)") {}
@@ -692,6 +815,12 @@ public:
 	bool run() const;
 };
 
+class MemPoolLifeTest : public TestRunnable {
+public:
+	MemPoolLifeTest() : TestRunnable("memory pool block outliving its driver") {}
+	bool run() const;
+};
+
 class EigBubFrankTest : public TestRunnable {
 public:
 	EigBubFrankTest() : TestRunnable("eig. bubble frank test (12x12)") {}
@@ -805,6 +934,16 @@ bool MultKronTransTest::run() const
 	return mult_kron(true, "qt7x7.mm", "v245.mm", "vcheck245a.mm", 7, 5, 2);
 }
 
+bool BlockKronTest::run() const
+{
+	return block_kron(false, "qt7x7.mm", "v245.mm", 7, 5, 2);
+}
+
+bool BlockKronTransTest::run() const
+{
+	return block_kron(true, "qt7x7.mm", "v245.mm", 7, 5, 2);
+}
+
 bool LevelKronTest::run() const
 {
 	return level_kron(false, "qt7x7.mm", "v1715.mm", "vcheck1715.mm", 2, 7, 5, 3);
@@ -879,6 +1018,25 @@ bool TriSylvLargeTest::run() const
 	return tri_sylv("qt40x40.mm", "qt30x30eig011-095.mm", "v1920000.mm", 40, 30, 3);
 }
 
+bool TriSylvPanelTest::run() const
+{
+	int pw = TriangularSylvester::getPanelWidth();
+	bool refused = false;
+	try {
+		TriangularSylvester::setPanelWidth(0);
+	} catch (SylvException& e) {
+		refused = true;
+	}
+	if (!refused || TriangularSylvester::getPanelWidth() != pw) {
+		printf("\tpanel width 0 not refused\n");
+		return false;
+	}
+	TriangularSylvester::setPanelWidth(3);
+	bool res = tri_sylv("qt40x40.mm", "qt30x30eig011-095.mm", "v48000.mm", 40, 30, 2);
+	TriangularSylvester::setPanelWidth(pw);
+	return res;
+}
+
 bool IterSylvTest::run() const
 {
 	return iter_sylv("qt7x7eig06-09.mm", "qt5x5.mm", "v245r.mm", 7, 5, 2);
@@ -899,6 +1057,11 @@ bool GenSylvTest::run() const
 	return gen_sylv("a30x30.mm", "b30x25.mm", "c20x20.mm", "d30x400.mm", 20, 30, 2);
 }
 
+bool GenSylvMultiTest::run() const
+{
+	return gen_sylv_multi("a30x30.mm", "b30x25.mm", "c20x20.mm", "d30x400.mm", 20, 30, 2, 3);
+}
+
 bool GenSylvSingTest::run() const
 {
 	return gen_sylv("a20x20.mm", "b20x4.mm", "c50x50sing.mm", "d20x125000.mm", 50, 20, 3);
@@ -909,6 +1072,55 @@ bool GenSylvLargeTest::run() const
 	return gen_sylv("a20x20.mm", "b20x15.mm", "c50x50.mm", "d20x125000.mm", 50, 20, 3);
 }
 
+#ifdef HAVE_PTHREAD
+extern "C" {
+	static void* delete_vector(void* v)
+	{
+		delete (Vector*) v;
+		return NULL;
+	}
+}
+#endif
+
+bool MemPoolLifeTest::run() const
+{
+	SylvMemoryPool& pool = SylvMemoryPool::current();
+	// allocate in stack mode, destroy the driver, then free
+	Vector* v1;
+	Vector* v2;
+	{
+		SylvMemoryDriver memdriver(1, 10, 10, 2);
+		memdriver.setStackMode(true);
+		v1 = new Vector(100);
+		v2 = new Vector(100);
+		memdriver.setStackMode(false);
+	}
+	v1->zeros();
+	v2->zeros();
+#ifdef HAVE_PTHREAD
+	// free the second block in another thread
+	pthread_t th;
+	if (pthread_create(&th, NULL, delete_vector, v2) != 0)
+		return false;
+	pthread_join(th, NULL);
+#else
+	delete v2;
+#endif
+	delete v1;
+	if (pool.getNumLive() != 0 || pool.isInitialized()) {
+		printf("\tpool not released after its last block\n");
+		return false;
+	}
+	// a new driver can initialize the pool again
+	SylvMemoryDriver memdriver(1, 10, 10, 2);
+	memdriver.setStackMode(true);
+	Vector* v3 = new Vector(100);
+	v3->zeros();
+	delete v3;
+	memdriver.setStackMode(false);
+	return pool.getNumLive() == 0;
+}
+
 bool EigBubFrankTest::run() const
 {
 	return eig_bubble("qt_frank12x12.mm", 8, 0);
@@ -966,6 +1178,8 @@ int main()
 	all_tests[num_tests++] = new MultKronTest();
 	all_tests[num_tests++] = new MultKronSmallTransTest();
 	all_tests[num_tests++] = new MultKronTransTest();
+	all_tests[num_tests++] = new BlockKronTest();
+	all_tests[num_tests++] = new BlockKronTransTest();
 	all_tests[num_tests++] = new LevelKronTest();
 	all_tests[num_tests++] = new LevelKronTransTest();
 	all_tests[num_tests++] = new LevelZeroKronTest();
@@ -987,12 +1201,15 @@ int main()
 	all_tests[num_tests++] = new TriSylvTest();
 	all_tests[num_tests++] = new TriSylvBigTest();
 	all_tests[num_tests++] = new TriSylvLargeTest();
+	all_tests[num_tests++] = new TriSylvPanelTest();
 	all_tests[num_tests++] = new IterSylvTest();
 	all_tests[num_tests++] = new IterSylvLargeTest();
 	all_tests[num_tests++] = new GenSylvSmallTest();
 	all_tests[num_tests++] = new GenSylvTest();
+	all_tests[num_tests++] = new GenSylvMultiTest();
 	all_tests[num_tests++] = new GenSylvSingTest();
 	all_tests[num_tests++] = new GenSylvLargeTest();
+	all_tests[num_tests++] = new MemPoolLifeTest();
 
 	// launch the tests
 	int success = 0;
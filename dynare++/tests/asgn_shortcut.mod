@@ -0,0 +1,47 @@
+// this is example1.mod with the parameter assignments evaluated in
+// order; psi is a product with zero factor, so its other factor
+// (using rho1 and rho2 not yet set) must not be evaluated, and rho
+// must get the sum of the values assigned later
+
+var Y, C, K, A, H, B;
+
+varexo EPS, NU;
+
+parameters rho, beta, alpha, delta, theta, psi, tau, zeta, rho1, rho2;
+alpha = 0.36;
+tau   = 0.025;
+beta  = 1/(1.03^0.25);
+delta = 0.025;
+zeta  = 0;
+psi   = zeta*((rho1+rho2)+1);
+rho1  = 0.5;
+rho2  = 0.45;
+rho   = rho1+rho2;
+theta = 2.95;
+
+
+model;
+C*theta*H^(1+psi) = (1-alpha)*Y;
+beta*exp(B)*C/exp(B(1))/C(1)*
+  (exp(B(1))*alpha*Y(1)/K(1)+1-delta) = 1;
+Y = exp(A)*K^alpha*H^(1-alpha);
+K = exp(B(-1))*(Y(-1)-C(-1)) + (1-delta)*K(-1);
+A = rho*A(-1) + tau*B(-1) + EPS;
+B = tau*A(-1) + rho*B(-1) + NU;
+end;
+
+initval;
+A = 0;
+B = 0;
+H = ((1-alpha)/(theta*(1-(delta*alpha)/(1/beta-1+delta))))^(1/(1+psi));
+Y = (alpha/(1/beta-1+delta))^(alpha/(1-alpha))*H;
+K = alpha/(1/beta-1+delta)*Y;
+C = Y - delta*K;
+end;
+
+vcov = [
+  0.0002  0.00005;
+  0.00005 0.0001
+];
+
+order = 2;
@@ -0,0 +1,459 @@
+// this is a stack of 70 one sector growth models linked by the
+// spillovers of the technology shocks; it has 210 endogenous variables,
+// so the deterministic steady state is solved with the sparse
+// Jacobian; the initial values are off the steady state
+
+var C1, K1, A1, C2, K2, A2, C3, K3, A3, C4, K4, A4, C5, K5, A5, C6, K6,
+  A6, C7, K7, A7, C8, K8, A8, C9, K9, A9, C10, K10, A10, C11, K11, A11,
+  C12, K12, A12, C13, K13, A13, C14, K14, A14, C15, K15, A15, C16, K16,
+  A16, C17, K17, A17, C18, K18, A18, C19, K19, A19, C20, K20, A20, C21,
+  K21, A21, C22, K22, A22, C23, K23, A23, C24, K24, A24, C25, K25, A25,
+  C26, K26, A26, C27, K27, A27, C28, K28, A28, C29, K29, A29, C30, K30,
+  A30, C31, K31, A31, C32, K32, A32, C33, K33, A33, C34, K34, A34, C35,
+  K35, A35, C36, K36, A36, C37, K37, A37, C38, K38, A38, C39, K39, A39,
+  C40, K40, A40, C41, K41, A41, C42, K42, A42, C43, K43, A43, C44, K44,
+  A44, C45, K45, A45, C46, K46, A46, C47, K47, A47, C48, K48, A48, C49,
+  K49, A49, C50, K50, A50, C51, K51, A51, C52, K52, A52, C53, K53, A53,
+  C54, K54, A54, C55, K55, A55, C56, K56, A56, C57, K57, A57, C58, K58,
+  A58, C59, K59, A59, C60, K60, A60, C61, K61, A61, C62, K62, A62, C63,
+  K63, A63, C64, K64, A64, C65, K65, A65, C66, K66, A66, C67, K67, A67,
+  C68, K68, A68, C69, K69, A69, C70, K70, A70;
+
+varexo EPS;
+
+parameters alpha, beta, delta, rho, tau;
+alpha = 0.36;
+beta  = 0.99;
+delta = 0.025;
+rho   = 0.9;
+tau   = 0.05;
+
+model;
+1/C1 = beta/C1(1)*(alpha*exp(A1(1))*K1^(alpha-1)+1-delta);
+K1 = exp(A1)*K1(-1)^alpha - C1 + (1-delta)*K1(-1);
+A1 = rho*A1(-1) + EPS;
+1/C2 = beta/C2(1)*(alpha*exp(A2(1))*K2^(alpha-1)+1-delta);
+K2 = exp(A2)*K2(-1)^alpha - C2 + (1-delta)*K2(-1);
+A2 = rho*A2(-1) + tau*A1(-1);
+1/C3 = beta/C3(1)*(alpha*exp(A3(1))*K3^(alpha-1)+1-delta);
+K3 = exp(A3)*K3(-1)^alpha - C3 + (1-delta)*K3(-1);
+A3 = rho*A3(-1) + tau*A2(-1);
+1/C4 = beta/C4(1)*(alpha*exp(A4(1))*K4^(alpha-1)+1-delta);
+K4 = exp(A4)*K4(-1)^alpha - C4 + (1-delta)*K4(-1);
+A4 = rho*A4(-1) + tau*A3(-1);
+1/C5 = beta/C5(1)*(alpha*exp(A5(1))*K5^(alpha-1)+1-delta);
+K5 = exp(A5)*K5(-1)^alpha - C5 + (1-delta)*K5(-1);
+A5 = rho*A5(-1) + tau*A4(-1);
+1/C6 = beta/C6(1)*(alpha*exp(A6(1))*K6^(alpha-1)+1-delta);
+K6 = exp(A6)*K6(-1)^alpha - C6 + (1-delta)*K6(-1);
+A6 = rho*A6(-1) + tau*A5(-1);
+1/C7 = beta/C7(1)*(alpha*exp(A7(1))*K7^(alpha-1)+1-delta);
+K7 = exp(A7)*K7(-1)^alpha - C7 + (1-delta)*K7(-1);
+A7 = rho*A7(-1) + tau*A6(-1);
+1/C8 = beta/C8(1)*(alpha*exp(A8(1))*K8^(alpha-1)+1-delta);
+K8 = exp(A8)*K8(-1)^alpha - C8 + (1-delta)*K8(-1);
+A8 = rho*A8(-1) + tau*A7(-1);
+1/C9 = beta/C9(1)*(alpha*exp(A9(1))*K9^(alpha-1)+1-delta);
+K9 = exp(A9)*K9(-1)^alpha - C9 + (1-delta)*K9(-1);
+A9 = rho*A9(-1) + tau*A8(-1);
+1/C10 = beta/C10(1)*(alpha*exp(A10(1))*K10^(alpha-1)+1-delta);
+K10 = exp(A10)*K10(-1)^alpha - C10 + (1-delta)*K10(-1);
+A10 = rho*A10(-1) + tau*A9(-1);
+1/C11 = beta/C11(1)*(alpha*exp(A11(1))*K11^(alpha-1)+1-delta);
+K11 = exp(A11)*K11(-1)^alpha - C11 + (1-delta)*K11(-1);
+A11 = rho*A11(-1) + tau*A10(-1);
+1/C12 = beta/C12(1)*(alpha*exp(A12(1))*K12^(alpha-1)+1-delta);
+K12 = exp(A12)*K12(-1)^alpha - C12 + (1-delta)*K12(-1);
+A12 = rho*A12(-1) + tau*A11(-1);
+1/C13 = beta/C13(1)*(alpha*exp(A13(1))*K13^(alpha-1)+1-delta);
+K13 = exp(A13)*K13(-1)^alpha - C13 + (1-delta)*K13(-1);
+A13 = rho*A13(-1) + tau*A12(-1);
+1/C14 = beta/C14(1)*(alpha*exp(A14(1))*K14^(alpha-1)+1-delta);
+K14 = exp(A14)*K14(-1)^alpha - C14 + (1-delta)*K14(-1);
+A14 = rho*A14(-1) + tau*A13(-1);
+1/C15 = beta/C15(1)*(alpha*exp(A15(1))*K15^(alpha-1)+1-delta);
+K15 = exp(A15)*K15(-1)^alpha - C15 + (1-delta)*K15(-1);
+A15 = rho*A15(-1) + tau*A14(-1);
+1/C16 = beta/C16(1)*(alpha*exp(A16(1))*K16^(alpha-1)+1-delta);
+K16 = exp(A16)*K16(-1)^alpha - C16 + (1-delta)*K16(-1);
+A16 = rho*A16(-1) + tau*A15(-1);
+1/C17 = beta/C17(1)*(alpha*exp(A17(1))*K17^(alpha-1)+1-delta);
+K17 = exp(A17)*K17(-1)^alpha - C17 + (1-delta)*K17(-1);
+A17 = rho*A17(-1) + tau*A16(-1);
+1/C18 = beta/C18(1)*(alpha*exp(A18(1))*K18^(alpha-1)+1-delta);
+K18 = exp(A18)*K18(-1)^alpha - C18 + (1-delta)*K18(-1);
+A18 = rho*A18(-1) + tau*A17(-1);
+1/C19 = beta/C19(1)*(alpha*exp(A19(1))*K19^(alpha-1)+1-delta);
+K19 = exp(A19)*K19(-1)^alpha - C19 + (1-delta)*K19(-1);
+A19 = rho*A19(-1) + tau*A18(-1);
+1/C20 = beta/C20(1)*(alpha*exp(A20(1))*K20^(alpha-1)+1-delta);
+K20 = exp(A20)*K20(-1)^alpha - C20 + (1-delta)*K20(-1);
+A20 = rho*A20(-1) + tau*A19(-1);
+1/C21 = beta/C21(1)*(alpha*exp(A21(1))*K21^(alpha-1)+1-delta);
+K21 = exp(A21)*K21(-1)^alpha - C21 + (1-delta)*K21(-1);
+A21 = rho*A21(-1) + tau*A20(-1);
+1/C22 = beta/C22(1)*(alpha*exp(A22(1))*K22^(alpha-1)+1-delta);
+K22 = exp(A22)*K22(-1)^alpha - C22 + (1-delta)*K22(-1);
+A22 = rho*A22(-1) + tau*A21(-1);
+1/C23 = beta/C23(1)*(alpha*exp(A23(1))*K23^(alpha-1)+1-delta);
+K23 = exp(A23)*K23(-1)^alpha - C23 + (1-delta)*K23(-1);
+A23 = rho*A23(-1) + tau*A22(-1);
+1/C24 = beta/C24(1)*(alpha*exp(A24(1))*K24^(alpha-1)+1-delta);
+K24 = exp(A24)*K24(-1)^alpha - C24 + (1-delta)*K24(-1);
+A24 = rho*A24(-1) + tau*A23(-1);
+1/C25 = beta/C25(1)*(alpha*exp(A25(1))*K25^(alpha-1)+1-delta);
+K25 = exp(A25)*K25(-1)^alpha - C25 + (1-delta)*K25(-1);
+A25 = rho*A25(-1) + tau*A24(-1);
+1/C26 = beta/C26(1)*(alpha*exp(A26(1))*K26^(alpha-1)+1-delta);
+K26 = exp(A26)*K26(-1)^alpha - C26 + (1-delta)*K26(-1);
+A26 = rho*A26(-1) + tau*A25(-1);
+1/C27 = beta/C27(1)*(alpha*exp(A27(1))*K27^(alpha-1)+1-delta);
+K27 = exp(A27)*K27(-1)^alpha - C27 + (1-delta)*K27(-1);
+A27 = rho*A27(-1) + tau*A26(-1);
+1/C28 = beta/C28(1)*(alpha*exp(A28(1))*K28^(alpha-1)+1-delta);
+K28 = exp(A28)*K28(-1)^alpha - C28 + (1-delta)*K28(-1);
+A28 = rho*A28(-1) + tau*A27(-1);
+1/C29 = beta/C29(1)*(alpha*exp(A29(1))*K29^(alpha-1)+1-delta);
+K29 = exp(A29)*K29(-1)^alpha - C29 + (1-delta)*K29(-1);
+A29 = rho*A29(-1) + tau*A28(-1);
+1/C30 = beta/C30(1)*(alpha*exp(A30(1))*K30^(alpha-1)+1-delta);
+K30 = exp(A30)*K30(-1)^alpha - C30 + (1-delta)*K30(-1);
+A30 = rho*A30(-1) + tau*A29(-1);
+1/C31 = beta/C31(1)*(alpha*exp(A31(1))*K31^(alpha-1)+1-delta);
+K31 = exp(A31)*K31(-1)^alpha - C31 + (1-delta)*K31(-1);
+A31 = rho*A31(-1) + tau*A30(-1);
+1/C32 = beta/C32(1)*(alpha*exp(A32(1))*K32^(alpha-1)+1-delta);
+K32 = exp(A32)*K32(-1)^alpha - C32 + (1-delta)*K32(-1);
+A32 = rho*A32(-1) + tau*A31(-1);
+1/C33 = beta/C33(1)*(alpha*exp(A33(1))*K33^(alpha-1)+1-delta);
+K33 = exp(A33)*K33(-1)^alpha - C33 + (1-delta)*K33(-1);
+A33 = rho*A33(-1) + tau*A32(-1);
+1/C34 = beta/C34(1)*(alpha*exp(A34(1))*K34^(alpha-1)+1-delta);
+K34 = exp(A34)*K34(-1)^alpha - C34 + (1-delta)*K34(-1);
+A34 = rho*A34(-1) + tau*A33(-1);
+1/C35 = beta/C35(1)*(alpha*exp(A35(1))*K35^(alpha-1)+1-delta);
+K35 = exp(A35)*K35(-1)^alpha - C35 + (1-delta)*K35(-1);
+A35 = rho*A35(-1) + tau*A34(-1);
+1/C36 = beta/C36(1)*(alpha*exp(A36(1))*K36^(alpha-1)+1-delta);
+K36 = exp(A36)*K36(-1)^alpha - C36 + (1-delta)*K36(-1);
+A36 = rho*A36(-1) + tau*A35(-1);
+1/C37 = beta/C37(1)*(alpha*exp(A37(1))*K37^(alpha-1)+1-delta);
+K37 = exp(A37)*K37(-1)^alpha - C37 + (1-delta)*K37(-1);
+A37 = rho*A37(-1) + tau*A36(-1);
+1/C38 = beta/C38(1)*(alpha*exp(A38(1))*K38^(alpha-1)+1-delta);
+K38 = exp(A38)*K38(-1)^alpha - C38 + (1-delta)*K38(-1);
+A38 = rho*A38(-1) + tau*A37(-1);
+1/C39 = beta/C39(1)*(alpha*exp(A39(1))*K39^(alpha-1)+1-delta);
+K39 = exp(A39)*K39(-1)^alpha - C39 + (1-delta)*K39(-1);
+A39 = rho*A39(-1) + tau*A38(-1);
+1/C40 = beta/C40(1)*(alpha*exp(A40(1))*K40^(alpha-1)+1-delta);
+K40 = exp(A40)*K40(-1)^alpha - C40 + (1-delta)*K40(-1);
+A40 = rho*A40(-1) + tau*A39(-1);
+1/C41 = beta/C41(1)*(alpha*exp(A41(1))*K41^(alpha-1)+1-delta);
+K41 = exp(A41)*K41(-1)^alpha - C41 + (1-delta)*K41(-1);
+A41 = rho*A41(-1) + tau*A40(-1);
+1/C42 = beta/C42(1)*(alpha*exp(A42(1))*K42^(alpha-1)+1-delta);
+K42 = exp(A42)*K42(-1)^alpha - C42 + (1-delta)*K42(-1);
+A42 = rho*A42(-1) + tau*A41(-1);
+1/C43 = beta/C43(1)*(alpha*exp(A43(1))*K43^(alpha-1)+1-delta);
+K43 = exp(A43)*K43(-1)^alpha - C43 + (1-delta)*K43(-1);
+A43 = rho*A43(-1) + tau*A42(-1);
+1/C44 = beta/C44(1)*(alpha*exp(A44(1))*K44^(alpha-1)+1-delta);
+K44 = exp(A44)*K44(-1)^alpha - C44 + (1-delta)*K44(-1);
+A44 = rho*A44(-1) + tau*A43(-1);
+1/C45 = beta/C45(1)*(alpha*exp(A45(1))*K45^(alpha-1)+1-delta);
+K45 = exp(A45)*K45(-1)^alpha - C45 + (1-delta)*K45(-1);
+A45 = rho*A45(-1) + tau*A44(-1);
+1/C46 = beta/C46(1)*(alpha*exp(A46(1))*K46^(alpha-1)+1-delta);
+K46 = exp(A46)*K46(-1)^alpha - C46 + (1-delta)*K46(-1);
+A46 = rho*A46(-1) + tau*A45(-1);
+1/C47 = beta/C47(1)*(alpha*exp(A47(1))*K47^(alpha-1)+1-delta);
+K47 = exp(A47)*K47(-1)^alpha - C47 + (1-delta)*K47(-1);
+A47 = rho*A47(-1) + tau*A46(-1);
+1/C48 = beta/C48(1)*(alpha*exp(A48(1))*K48^(alpha-1)+1-delta);
+K48 = exp(A48)*K48(-1)^alpha - C48 + (1-delta)*K48(-1);
+A48 = rho*A48(-1) + tau*A47(-1);
+1/C49 = beta/C49(1)*(alpha*exp(A49(1))*K49^(alpha-1)+1-delta);
+K49 = exp(A49)*K49(-1)^alpha - C49 + (1-delta)*K49(-1);
+A49 = rho*A49(-1) + tau*A48(-1);
+1/C50 = beta/C50(1)*(alpha*exp(A50(1))*K50^(alpha-1)+1-delta);
+K50 = exp(A50)*K50(-1)^alpha - C50 + (1-delta)*K50(-1);
+A50 = rho*A50(-1) + tau*A49(-1);
+1/C51 = beta/C51(1)*(alpha*exp(A51(1))*K51^(alpha-1)+1-delta);
+K51 = exp(A51)*K51(-1)^alpha - C51 + (1-delta)*K51(-1);
+A51 = rho*A51(-1) + tau*A50(-1);
+1/C52 = beta/C52(1)*(alpha*exp(A52(1))*K52^(alpha-1)+1-delta);
+K52 = exp(A52)*K52(-1)^alpha - C52 + (1-delta)*K52(-1);
+A52 = rho*A52(-1) + tau*A51(-1);
+1/C53 = beta/C53(1)*(alpha*exp(A53(1))*K53^(alpha-1)+1-delta);
+K53 = exp(A53)*K53(-1)^alpha - C53 + (1-delta)*K53(-1);
+A53 = rho*A53(-1) + tau*A52(-1);
+1/C54 = beta/C54(1)*(alpha*exp(A54(1))*K54^(alpha-1)+1-delta);
+K54 = exp(A54)*K54(-1)^alpha - C54 + (1-delta)*K54(-1);
+A54 = rho*A54(-1) + tau*A53(-1);
+1/C55 = beta/C55(1)*(alpha*exp(A55(1))*K55^(alpha-1)+1-delta);
+K55 = exp(A55)*K55(-1)^alpha - C55 + (1-delta)*K55(-1);
+A55 = rho*A55(-1) + tau*A54(-1);
+1/C56 = beta/C56(1)*(alpha*exp(A56(1))*K56^(alpha-1)+1-delta);
+K56 = exp(A56)*K56(-1)^alpha - C56 + (1-delta)*K56(-1);
+A56 = rho*A56(-1) + tau*A55(-1);
+1/C57 = beta/C57(1)*(alpha*exp(A57(1))*K57^(alpha-1)+1-delta);
+K57 = exp(A57)*K57(-1)^alpha - C57 + (1-delta)*K57(-1);
+A57 = rho*A57(-1) + tau*A56(-1);
+1/C58 = beta/C58(1)*(alpha*exp(A58(1))*K58^(alpha-1)+1-delta);
+K58 = exp(A58)*K58(-1)^alpha - C58 + (1-delta)*K58(-1);
+A58 = rho*A58(-1) + tau*A57(-1);
+1/C59 = beta/C59(1)*(alpha*exp(A59(1))*K59^(alpha-1)+1-delta);
+K59 = exp(A59)*K59(-1)^alpha - C59 + (1-delta)*K59(-1);
+A59 = rho*A59(-1) + tau*A58(-1);
+1/C60 = beta/C60(1)*(alpha*exp(A60(1))*K60^(alpha-1)+1-delta);
+K60 = exp(A60)*K60(-1)^alpha - C60 + (1-delta)*K60(-1);
+A60 = rho*A60(-1) + tau*A59(-1);
+1/C61 = beta/C61(1)*(alpha*exp(A61(1))*K61^(alpha-1)+1-delta);
+K61 = exp(A61)*K61(-1)^alpha - C61 + (1-delta)*K61(-1);
+A61 = rho*A61(-1) + tau*A60(-1);
+1/C62 = beta/C62(1)*(alpha*exp(A62(1))*K62^(alpha-1)+1-delta);
+K62 = exp(A62)*K62(-1)^alpha - C62 + (1-delta)*K62(-1);
+A62 = rho*A62(-1) + tau*A61(-1);
+1/C63 = beta/C63(1)*(alpha*exp(A63(1))*K63^(alpha-1)+1-delta);
+K63 = exp(A63)*K63(-1)^alpha - C63 + (1-delta)*K63(-1);
+A63 = rho*A63(-1) + tau*A62(-1);
+1/C64 = beta/C64(1)*(alpha*exp(A64(1))*K64^(alpha-1)+1-delta);
+K64 = exp(A64)*K64(-1)^alpha - C64 + (1-delta)*K64(-1);
+A64 = rho*A64(-1) + tau*A63(-1);
+1/C65 = beta/C65(1)*(alpha*exp(A65(1))*K65^(alpha-1)+1-delta);
+K65 = exp(A65)*K65(-1)^alpha - C65 + (1-delta)*K65(-1);
+A65 = rho*A65(-1) + tau*A64(-1);
+1/C66 = beta/C66(1)*(alpha*exp(A66(1))*K66^(alpha-1)+1-delta);
+K66 = exp(A66)*K66(-1)^alpha - C66 + (1-delta)*K66(-1);
+A66 = rho*A66(-1) + tau*A65(-1);
+1/C67 = beta/C67(1)*(alpha*exp(A67(1))*K67^(alpha-1)+1-delta);
+K67 = exp(A67)*K67(-1)^alpha - C67 + (1-delta)*K67(-1);
+A67 = rho*A67(-1) + tau*A66(-1);
+1/C68 = beta/C68(1)*(alpha*exp(A68(1))*K68^(alpha-1)+1-delta);
+K68 = exp(A68)*K68(-1)^alpha - C68 + (1-delta)*K68(-1);
+A68 = rho*A68(-1) + tau*A67(-1);
+1/C69 = beta/C69(1)*(alpha*exp(A69(1))*K69^(alpha-1)+1-delta);
+K69 = exp(A69)*K69(-1)^alpha - C69 + (1-delta)*K69(-1);
+A69 = rho*A69(-1) + tau*A68(-1);
+1/C70 = beta/C70(1)*(alpha*exp(A70(1))*K70^(alpha-1)+1-delta);
+K70 = exp(A70)*K70(-1)^alpha - C70 + (1-delta)*K70(-1);
+A70 = rho*A70(-1) + tau*A69(-1);
+end;
+
+initval;
+A1 = 0;
+K1 = 0.98*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C1 = 1;
+A2 = 0;
+K2 = 0.99*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C2 = 1;
+A3 = 0;
+K3 = 1*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C3 = 1;
+A4 = 0;
+K4 = 1.01*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C4 = 1;
+A5 = 0;
+K5 = 1.02*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C5 = 1;
+A6 = 0;
+K6 = 1.03*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C6 = 1;
+A7 = 0;
+K7 = 0.97*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C7 = 1;
+A8 = 0;
+K8 = 0.98*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C8 = 1;
+A9 = 0;
+K9 = 0.99*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C9 = 1;
+A10 = 0;
+K10 = 1*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C10 = 1;
+A11 = 0;
+K11 = 1.01*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C11 = 1;
+A12 = 0;
+K12 = 1.02*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C12 = 1;
+A13 = 0;
+K13 = 1.03*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C13 = 1;
+A14 = 0;
+K14 = 0.97*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C14 = 1;
+A15 = 0;
+K15 = 0.98*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C15 = 1;
+A16 = 0;
+K16 = 0.99*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C16 = 1;
+A17 = 0;
+K17 = 1*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C17 = 1;
+A18 = 0;
+K18 = 1.01*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C18 = 1;
+A19 = 0;
+K19 = 1.02*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C19 = 1;
+A20 = 0;
+K20 = 1.03*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C20 = 1;
+A21 = 0;
+K21 = 0.97*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C21 = 1;
+A22 = 0;
+K22 = 0.98*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C22 = 1;
+A23 = 0;
+K23 = 0.99*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C23 = 1;
+A24 = 0;
+K24 = 1*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C24 = 1;
+A25 = 0;
+K25 = 1.01*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C25 = 1;
+A26 = 0;
+K26 = 1.02*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C26 = 1;
+A27 = 0;
+K27 = 1.03*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C27 = 1;
+A28 = 0;
+K28 = 0.97*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C28 = 1;
+A29 = 0;
+K29 = 0.98*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C29 = 1;
+A30 = 0;
+K30 = 0.99*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C30 = 1;
+A31 = 0;
+K31 = 1*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C31 = 1;
+A32 = 0;
+K32 = 1.01*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C32 = 1;
+A33 = 0;
+K33 = 1.02*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C33 = 1;
+A34 = 0;
+K34 = 1.03*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C34 = 1;
+A35 = 0;
+K35 = 0.97*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C35 = 1;
+A36 = 0;
+K36 = 0.98*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C36 = 1;
+A37 = 0;
+K37 = 0.99*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C37 = 1;
+A38 = 0;
+K38 = 1*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C38 = 1;
+A39 = 0;
+K39 = 1.01*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C39 = 1;
+A40 = 0;
+K40 = 1.02*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C40 = 1;
+A41 = 0;
+K41 = 1.03*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C41 = 1;
+A42 = 0;
+K42 = 0.97*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C42 = 1;
+A43 = 0;
+K43 = 0.98*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C43 = 1;
+A44 = 0;
+K44 = 0.99*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C44 = 1;
+A45 = 0;
+K45 = 1*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C45 = 1;
+A46 = 0;
+K46 = 1.01*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C46 = 1;
+A47 = 0;
+K47 = 1.02*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C47 = 1;
+A48 = 0;
+K48 = 1.03*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C48 = 1;
+A49 = 0;
+K49 = 0.97*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C49 = 1;
+A50 = 0;
+K50 = 0.98*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C50 = 1;
+A51 = 0;
+K51 = 0.99*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C51 = 1;
+A52 = 0;
+K52 = 1*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C52 = 1;
+A53 = 0;
+K53 = 1.01*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C53 = 1;
+A54 = 0;
+K54 = 1.02*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C54 = 1;
+A55 = 0;
+K55 = 1.03*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C55 = 1;
+A56 = 0;
+K56 = 0.97*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C56 = 1;
+A57 = 0;
+K57 = 0.98*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C57 = 1;
+A58 = 0;
+K58 = 0.99*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C58 = 1;
+A59 = 0;
+K59 = 1*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C59 = 1;
+A60 = 0;
+K60 = 1.01*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C60 = 1;
+A61 = 0;
+K61 = 1.02*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C61 = 1;
+A62 = 0;
+K62 = 1.03*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C62 = 1;
+A63 = 0;
+K63 = 0.97*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C63 = 1;
+A64 = 0;
+K64 = 0.98*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C64 = 1;
+A65 = 0;
+K65 = 0.99*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C65 = 1;
+A66 = 0;
+K66 = 1*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C66 = 1;
+A67 = 0;
+K67 = 1.01*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C67 = 1;
+A68 = 0;
+K68 = 1.02*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C68 = 1;
+A69 = 0;
+K69 = 1.03*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C69 = 1;
+A70 = 0;
+K70 = 0.97*(alpha/(1/beta-1+delta))^(1/(1-alpha));
+C70 = 1;
+end;
+
+vcov = [0.0001];
+
+order = 2;
@@ -16,6 +16,7 @@
 #include <cstdio>
 #include <cstring>
 #include <ctime>
+#include <cmath>
 
 
 class TestRunnable {
@@ -60,9 +61,18 @@ protected:
 			return fold_unfold(folded); // folded deallocated in fold_unfold
 		}
 
+	static bool gs_unfold_map(int r, const Symmetry& s, const IntSequence& nvs);
+	static bool fs_unfold_map(int r, int nv, int dim);
+
+	static bool int_sequence(int len);
+
+	static bool equivalence_cache(int n);
+
 	static bool dense_prod(const Symmetry& bsym, const IntSequence& bnvs,
 						   int hdim, int hnv, int rows);
 
+	static bool kron_prod(int rows, int m, int n, int dim, int unit);
+
 	static bool folded_monomial(int ng, int nx, int ny, int nu, int dim);
 
 	static bool unfolded_monomial(int ng, int nx, int ny, int nu, int dim);
@@ -79,6 +89,8 @@ protected:
 
 	static bool poly_eval(int r, int nv, int maxdim);
 
+	static bool poly_eval_points(int r, int nv, int maxdim, int np);
+
 
 };
 
@@ -198,6 +210,199 @@ bool TestRunnable::fold_unfold(const FTensor* folded)
 	return normInf < 1.0e-15;
 }
 
+/* Unfolds with the fold map and checks each unfolded column against
+ * the folded column of the sorted index. */
+bool TestRunnable::gs_unfold_map(int r, const Symmetry& s, const IntSequence& nvs)
+{
+	Factory f;
+	FGSTensor* folded = f.make<FGSTensor>(r, s, nvs);
+	clock_t s1 = clock();
+	UGSTensor unfolded(*folded);
+	FGSTensor folded2(unfolded);
+	clock_t s2 = clock();
+	double norm = 0.0;
+	for (Tensor::index ui = unfolded.begin(); ui != unfolded.end(); ++ui) {
+		Tensor::index fi(folded, unfolded.getFirstIndexOf(ui).getCoor());
+		for (int i = 0; i < r; i++)
+			norm = max(norm, fabs(unfolded.get(i, *ui) - folded->get(i, *fi)));
+	}
+	folded2.add(-1.0, *folded);
+	double normInf = folded2.getNormInf();
+	printf("\tunfolded size:          (%d, %d)\n", unfolded.nrows(), unfolded.ncols());
+	printf("\ttime for unfold & fold: %8.4g\n", ((double)(s2-s1))/CLOCKS_PER_SEC);
+	printf("\tunfolded error normMax: %10.6g\n", norm);
+	printf("\tfolded error normInf:   %10.6g\n", normInf);
+	delete folded;
+	return norm == 0.0 && normInf == 0.0;
+}
+
+bool TestRunnable::fs_unfold_map(int r, int nv, int dim)
+{
+	Factory f;
+	FFSTensor* folded = f.make<FFSTensor>(r, nv, dim);
+	clock_t s1 = clock();
+	UFSTensor unfolded(*folded);
+	FFSTensor folded2(unfolded);
+	clock_t s2 = clock();
+	double norm = 0.0;
+	for (Tensor::index ui = unfolded.begin(); ui != unfolded.end(); ++ui) {
+		IntSequence v(ui.getCoor());
+		v.sort();
+		Tensor::index fi(folded, v);
+		for (int i = 0; i < r; i++)
+			norm = max(norm, fabs(unfolded.get(i, *ui) - folded->get(i, *fi)));
+	}
+	folded2.add(-1.0, *folded);
+	double normInf = folded2.getNormInf();
+	printf("\tunfolded size:          (%d, %d)\n", unfolded.nrows(), unfolded.ncols());
+	printf("\ttime for unfold & fold: %8.4g\n", ((double)(s2-s1))/CLOCKS_PER_SEC);
+	printf("\tunfolded error normMax: %10.6g\n", norm);
+	printf("\tfolded error normInf:   %10.6g\n", normInf);
+	delete folded;
+	return norm == 0.0 && normInf == 0.0;
+}
+
+/* Saves the equivalence sets up to n, loads them to a new bundle and
+ * compares. Then checks that saving again replaces the file rather
+ * than rewriting it, so that a reader of the old file still sees it
+ * whole, and that a truncated file is refused. */
+// true if the data of the sequence are stored in the instance
+static bool is_local(IntSequence& s)
+{
+	const char* p = (const char*)&(s[0]);
+	return (const char*)&s <= p && p < (const char*)&s + sizeof(IntSequence);
+}
+
+// true if the sequence is i*3+1+shift for all i
+static bool has_values(const IntSequence& s, int len, int shift)
+{
+	bool ok = (s.size() == len);
+	for (int i = 0; ok && i < len; i++)
+		ok = (s[i] == 3*i+1+shift);
+	return ok;
+}
+
+bool TestRunnable::int_sequence(int len)
+{
+	bool small = (len <= 8);
+	int other = small ? 9 : 8; // length on the other side of the limit
+	IntSequence a(len);
+	for (int i = 0; i < len; i++)
+		a[i] = 3*i+1;
+	bool storage = (is_local(a) == small);
+
+	// copies
+	IntSequence b(a);
+	b[0] = 0;
+	IntSequence c(other, 0);
+	c = a;
+	bool ccopy = ((&c[0] != &a[0]) && is_local(c) == small);
+	c[0] = 0;
+	bool copy = (storage && has_values(a, len, 0) && b.size() == len && b[1] == 4
+				 && is_local(b) == small && ccopy && c.size() == len && c[1] == 4);
+
+	// moves
+	bool move = true;
+#if __cplusplus >= 201103L
+	IntSequence d(a);
+	const int* dp = &(d[0]);
+	IntSequence e(std::move(d));
+	if (small)
+		move = (is_local(e) && has_values(d, len, 0));
+	else
+		move = (&(e[0]) == dp && d.size() == 0);
+	move = move && has_values(e, len, 0);
+	IntSequence f(a);
+	const int* fp = &(f[0]);
+	IntSequence g(other, 0);
+	g = std::move(f);
+	if (small)
+		move = move && is_local(g) && has_values(f, len, 0);
+	else
+		move = move && &(g[0]) == fp && f.size() == 0;
+	move = move && has_values(g, len, 0);
+	IntSequence h(len, 0);
+	h = IntSequence(other, 5);
+	move = move && h.size() == other && is_local(h) == !small && h[other-1] == 5;
+#endif
+
+	// subsequences referencing the storage of a
+	IntSequence sub(a, 1, len-1);
+	bool subseq = (&(sub[0]) == &(a[1]) && sub.size() == len-2);
+	sub[0] = -1;
+	subseq = subseq && a[1] == -1;
+	sub = IntSequence(len-2, 7);
+	subseq = subseq && &(sub[0]) == &(a[1]) && a[1] == 7 && a[len-2] == 7
+		&& a[0] == 1 && a[len-1] == 3*(len-1)+1;
+#if __cplusplus >= 201103L
+	IntSequence moved(std::move(sub));
+	moved[0] = 0;
+	subseq = subseq && &(sub[0]) == &(a[1]) && sub.size() == len-2 && a[1] == 7;
+#endif
+	const IntSequence& ca = a;
+	IntSequence csub(ca, 1, len-1);
+	csub[0] = 0;
+	subseq = subseq && &(csub[0]) != &(a[1]) && a[1] == 7 && is_local(csub) == (len-2 <= 8);
+
+	printf("\tstored in instance:     %s\n", is_local(a) ? "yes" : "no");
+	printf("\tcopy, move, subseq:     %s %s %s\n", copy ? "ok" : "wrong",
+		   move ? "ok" : "wrong", subseq ? "ok" : "wrong");
+	return copy && move && subseq;
+}
+
+bool TestRunnable::equivalence_cache(int n)
+{
+	const char* fname = "tl_equivalence_cache.tmp";
+	clock_t s1 = clock();
+	EquivalenceBundle generated(n);
+	clock_t s2 = clock();
+	generated.save(fname);
+	EquivalenceBundle loaded(1);
+	bool ok = loaded.load(fname);
+	clock_t s3 = clock();
+	int num = 0;
+	for (int k = 1; ok && k <= n; k++) {
+		const EquivalenceSet& es1 = generated.get(k);
+		const EquivalenceSet& es2 = loaded.get(k);
+		EquivalenceSet::const_iterator it1 = es1.begin();
+		EquivalenceSet::const_iterator it2 = es2.begin();
+		for (; ok && it1 != es1.end() && it2 != es2.end(); ++it1, ++it2, num++)
+			ok = (*it1 == *it2 && (*it1).numClasses() == (*it2).numClasses());
+		ok = ok && it1 == es1.end() && it2 == es2.end();
+	}
+
+	FILE* fd = fopen(fname, "rb");
+	vector<char> buf;
+	int c;
+	while ((c = fgetc(fd)) != EOF)
+		buf.push_back((char)c);
+	rewind(fd);
+	EquivalenceBundle bigger(n+1);
+	bigger.save(fname);
+	vector<char> oldbuf;
+	while ((c = fgetc(fd)) != EOF)
+		oldbuf.push_back((char)c);
+	fclose(fd);
+	bool replaced = (oldbuf == buf);
+	EquivalenceBundle reloaded(1);
+	replaced = replaced && reloaded.load(fname);
+	replaced = replaced && reloaded.get(n+1).begin() != reloaded.get(n+1).end();
+
+	fd = fopen(fname, "wb");
+	fwrite(&(buf[0]), 1, buf.size() - sizeof(int), fd);
+	fclose(fd);
+	EquivalenceBundle truncated(1);
+	bool refused = ! truncated.load(fname);
+	remove(fname);
+
+	printf("\tnumber of equivalences: %d\n", num);
+	printf("\ttime for generating:    %8.4g\n", ((double)(s2-s1))/CLOCKS_PER_SEC);
+	printf("\ttime for loading:       %8.4g\n", ((double)(s3-s2))/CLOCKS_PER_SEC);
+	printf("\told file kept by reader: %s\n", replaced ? "yes" : "no");
+	printf("\ttruncated file refused: %s\n", refused ? "yes" : "no");
+	return ok && replaced && refused;
+}
+
 bool TestRunnable::dense_prod(const Symmetry& bsym, const IntSequence& bnvs,
 							  int hdim, int hnv, int rows)
 {
@@ -242,6 +447,64 @@ bool TestRunnable::dense_prod(const Symmetry& bsym, const IntSequence& bnvs,
 	return norm < 1.e-13;
 }
 
+/* Multiplies a matrix by a Kronecker product of |dim| random m x n
+ * matrices, where the matrix |unit| (if non-negative) is replaced by an m
+ * x m identity, and compares to the product with the explicitly formed
+ * Kronecker product. The multiplied matrix is a submatrix, so its leading
+ * dimension differs from the number of rows. */
+bool TestRunnable::kron_prod(int rows, int m, int n, int dim, int unit)
+{
+	Factory f;
+	TwoDMatrix a(m, n);
+	for (int i = 0; i < m; i++)
+		for (int j = 0; j < n; j++)
+			a.get(i, j) = f.get();
+	KronProdAll kp(dim);
+	for (int i = 0; i < dim; i++)
+		if (i == unit)
+			kp.setUnit(i, m);
+		else
+			kp.setMat(i, a);
+
+	TwoDMatrix big(rows+3, kp.nrows());
+	for (int i = 0; i < big.nrows(); i++)
+		for (int j = 0; j < big.ncols(); j++)
+			big.get(i, j) = f.get();
+	ConstTwoDMatrix in(2, rows, big);
+
+	TwoDMatrix kron(kp.nrows(), kp.ncols());
+	IntSequence irows(dim);
+	for (int i = 0; i < kp.nrows(); i++) {
+		int p = i;
+		for (int k = dim-1; k >= 0; k--) {
+			irows[k] = p % kp.nrows(k);
+			p /= kp.nrows(k);
+		}
+		Vector* row = kp.multRows(irows);
+		for (int j = 0; j < kp.ncols(); j++)
+			kron.get(i, j) = (*row)[j];
+		delete row;
+	}
+
+	TwoDMatrix out(rows, kp.ncols());
+	clock_t s1 = clock();
+	kp.mult(in, out);
+	clock_t s2 = clock();
+	TwoDMatrix check(rows, kp.ncols());
+	check.mult(in, ConstTwoDMatrix(kron));
+	clock_t s3 = clock();
+	check.add(-1.0, out);
+	double norm = check.getData().getMax();
+
+	printf("	time for Kronecker product:  %8.4g\n",
+		   ((double)(s2-s1))/CLOCKS_PER_SEC);
+	printf("	time for explicit product:   %8.4g\n",
+		   ((double)(s3-s2))/CLOCKS_PER_SEC);
+	printf("	difference normMax:          %10.6g\n", norm);
+
+	return norm < 1.e-12;
+}
+
 bool TestRunnable::folded_monomial(int ng, int nx, int ny, int nu, int dim)
 {
 	clock_t gen_time = clock();
@@ -547,6 +810,64 @@ bool TestRunnable::poly_eval(int r, int nv, int maxdim)
 	return (max_ft+max_fh+max_uh < 1.0e-10);
 }
 
+/* Evaluates the polynomial at np points at once (folded, unfolded and
+ * compact) and compares with the Horner evaluation point by point. */
+bool TestRunnable::poly_eval_points(int r, int nv, int maxdim, int np)
+{
+	Factory fact;
+	Vector* xv = fact.makeVector(nv*np);
+	ConstTwoDMatrix xs(nv, np, xv->base());
+	FTensorPolynomial* fp = fact.makePoly<FFSTensor, FTensorPolynomial>(r, nv, maxdim);
+	UTensorPolynomial up(*fp);
+	FCompactPolynomial fcp(*fp);
+
+	TwoDMatrix out_h(r, np);
+	clock_t h_cl = clock();
+	for (int j = 0; j < np; j++) {
+		Vector outj(out_h, j);
+		fp->evalHorner(outj, ConstVector(xs, j));
+	}
+	h_cl = clock() - h_cl;
+	printf("\ttime for horner eval per point:   %8.4g\n",
+		   ((double)h_cl)/CLOCKS_PER_SEC);
+
+	TwoDMatrix out_f(r, np);
+	clock_t f_cl = clock();
+	fp->evalTrad(out_f, xs);
+	f_cl = clock() - f_cl;
+	printf("\ttime for folded eval at points:   %8.4g\n",
+		   ((double)f_cl)/CLOCKS_PER_SEC);
+
+	TwoDMatrix out_u(r, np);
+	clock_t u_cl = clock();
+	up.evalTrad(out_u, xs);
+	u_cl = clock() - u_cl;
+	printf("\ttime for unfolded eval at points: %8.4g\n",
+		   ((double)u_cl)/CLOCKS_PER_SEC);
+
+	TwoDMatrix out_c(r, np);
+	clock_t c_cl = clock();
+	fcp.eval(out_c, xs);
+	c_cl = clock() - c_cl;
+	printf("\ttime for compact eval at points:  %8.4g\n",
+		   ((double)c_cl)/CLOCKS_PER_SEC);
+
+	out_f.add(-1.0, out_h);
+	double max_f = out_f.getData().getMax();
+	out_u.add(-1.0, out_h);
+	double max_u = out_u.getData().getMax();
+	out_c.add(-1.0, out_h);
+	double max_c = out_c.getData().getMax();
+
+	printf("\tfolded error norm max:    %10.6g\n", max_f);
+	printf("\tunfolded error norm max:  %10.6g\n", max_u);
+	printf("\tcompact error norm max:   %10.6g\n", max_c);
+
+	delete fp;
+	delete xv;
+	return (max_f+max_u+max_c < 1.0e-10);
+}
+
 
 /****************************************************/
 /*     definition of TestRunnable subclasses        */
@@ -761,6 +1082,57 @@ public:
 		}
 };
 
+class GSUnfoldMap : public TestRunnable {
+public:
+	GSUnfoldMap()
+		: TestRunnable("unfold map gs (r,s,nvs)=(10,(0,2,3,1),(5,4,3,2))",6,5) {}
+	bool run() const
+		{
+			IntSequence nvs(4); nvs[0] = 5; nvs[1] = 4; nvs[2] = 3; nvs[3] = 2;
+			return gs_unfold_map(10, Symmetry(0,2,3,1), nvs);
+		}
+};
+
+class FSUnfoldMap : public TestRunnable {
+public:
+	FSUnfoldMap()
+		: TestRunnable("unfold map fs (r,nv,dim)=(10,9,4)",4,9) {}
+	bool run() const
+		{
+			return fs_unfold_map(10, 9, 4);
+		}
+};
+
+class IntSequenceSmall : public TestRunnable {
+public:
+	IntSequenceSmall()
+		: TestRunnable("int sequence in instance (l)=(8)",1,1) {}
+	bool run() const
+		{
+			return int_sequence(8);
+		}
+};
+
+class IntSequenceBig : public TestRunnable {
+public:
+	IntSequenceBig()
+		: TestRunnable("int sequence on heap (l)=(9)",1,1) {}
+	bool run() const
+		{
+			return int_sequence(9);
+		}
+};
+
+class EquivalenceCache : public TestRunnable {
+public:
+	EquivalenceCache()
+		: TestRunnable("equivalence cache (n)=(7)",1,1) {}
+	bool run() const
+		{
+			return equivalence_cache(7);
+		}
+};
+
 class SmallDenseProd : public TestRunnable {
 public:
 	SmallDenseProd()
@@ -794,6 +1166,36 @@ public:
 		}
 };
 
+class SmallKronMult : public TestRunnable {
+public:
+	SmallKronMult()
+		: TestRunnable("small kron prod r=5,A=4x3,dim=3,unit=1",3,4) {}
+	bool run() const
+		{
+			return kron_prod(5, 4, 3, 3, 1);
+		}
+};
+
+class KronMult : public TestRunnable {
+public:
+	KronMult()
+		: TestRunnable("kron prod r=20,A=7x9,dim=4",4,9) {}
+	bool run() const
+		{
+			return kron_prod(20, 7, 9, 4, -1);
+		}
+};
+
+class TallKronMult : public TestRunnable {
+public:
+	TallKronMult()
+		: TestRunnable("tall kron prod r=2500,A=4x5,dim=4,unit=3",4,5) {}
+	bool run() const
+		{
+			return kron_prod(2500, 4, 5, 4, 3);
+		}
+};
+
 class SmallFoldedMonomial : public TestRunnable {
 public:
 	SmallFoldedMonomial()
@@ -894,6 +1296,16 @@ public:
 		}
 };
 
+class PolyEvalPoints : public TestRunnable {
+public:
+	PolyEvalPoints()
+		: TestRunnable("polynomial evaluation at points (r=20, nv=8, maxdim=4, np=500)", 4, 9) {}
+	bool run() const
+		{
+			return poly_eval_points(20, 8, 4, 500);
+		}
+};
+
 class FoldZContSmall : public TestRunnable {
 public:
 	FoldZContSmall()
@@ -963,9 +1375,17 @@ int main()
 	all_tests[num_tests++] = new FoldUnfoldGS();
 	all_tests[num_tests++] = new SmallFoldUnfoldR();
 	all_tests[num_tests++] = new FoldUnfoldR();
+	all_tests[num_tests++] = new GSUnfoldMap();
+	all_tests[num_tests++] = new FSUnfoldMap();
+	all_tests[num_tests++] = new IntSequenceSmall();
+	all_tests[num_tests++] = new IntSequenceBig();
+	all_tests[num_tests++] = new EquivalenceCache();
 	all_tests[num_tests++] = new SmallDenseProd();
 	all_tests[num_tests++] = new DenseProd();
 	all_tests[num_tests++] = new BigDenseProd();
+	all_tests[num_tests++] = new SmallKronMult();
+	all_tests[num_tests++] = new KronMult();
+	all_tests[num_tests++] = new TallKronMult();
 	all_tests[num_tests++] = new SmallFoldedMonomial();
 	all_tests[num_tests++] = new FoldedMonomial();
 	all_tests[num_tests++] = new SmallUnfoldedMonomial();
@@ -976,6 +1396,7 @@ int main()
 	all_tests[num_tests++] = new UnfoldedContractionBig();
 	all_tests[num_tests++] = new PolyEvalSmall();
 	all_tests[num_tests++] = new PolyEvalBig();
+	all_tests[num_tests++] = new PolyEvalPoints();
 	all_tests[num_tests++] = new FoldZContSmall();
 	all_tests[num_tests++] = new FoldZCont();
 	all_tests[num_tests++] = new UnfoldZContSmall();
@@ -159,6 +159,9 @@ mex_status(4,3) = {'Sparse kronecker products'};
 mex_status(5,1) = {'local_state_space_iteration_2'};
 mex_status(5,2) = {'reduced_form_models/local_state_space_iteration_2'};
 mex_status(5,3) = {'Local state space iteration (second order)'};
+mex_status(6,1) = {'A_times_kronecker_B1_Bk'};
+mex_status(6,2) = {'kronecker'};
+mex_status(6,3) = {'Kronecker products of several matrices'};
 number_of_mex_files = size(mex_status,1);
 
 % Remove some directories from matlab's path. This is necessary if the user has
@@ -0,0 +1,122 @@
+function [D, err] = A_times_kronecker_B1_Bk(A,B,fake,folded)
+
+%@info:
+%! @deftypefn {Function File} {[@var{D}, @var{err}] =} A_times_kronecker_B1_Bk (@var{A},@var{B},@var{fake},@var{folded})
+%! @anchor{kronecker/A_times_kronecker_B1_Bk}
+%! @sp 1
+%! Computes A*kron(B@{1@},...,B@{k@}).
+%! @sp 2
+%! @strong{Inputs}
+%! @sp 1
+%! @table @ @var
+%! @item A
+%! mA*nA matrix of doubles.
+%! @item B
+%! 1*k cell array of matrices of doubles, B@{i@} being mBi*nBi and nA being equal to mB1*...*mBk.
+%! @item fake
+%! Anything you want, just a fake parameter (because the mex version admits a third argument specifying the number of threads to be used in parallel mode).
+%! @item folded
+%! Logical scalar (optional, default is false). If true, all the matrices in B must be equal and only the columns (j1,...,jk) of the result such that j1<=...<=jk are returned (in lexicographic order).
+%! @end table
+%! @sp 2
+%! @strong{Outputs}
+%! @sp 1
+%! @table @ @var
+%! @item D
+%! mA*(nB1*...*nBk) matrix of doubles, or mA*binomial(nB1+k-1,k) matrix of doubles if folded is true.
+%! @item err
+%! Integer scalar equal to zero (if all goes well).
+%! @end table
+%! @sp 2
+%! @strong{Remarks}
+%! @sp 1
+%! [1] This routine is called by Dynare if and only the mex version is not compiled (also used for testing purposes).
+%! @sp 1
+%! [2] The Kronecker product is never formed, the matrices in B are applied one after the other.
+%! @sp 2
+%! @strong{This function is called by:}
+%! @sp 2
+%! @strong{This function calls:}
+%!
+%! @end deftypefn
+%@eod:
+
+% Copyright (C) 2012 Dynare Team
+%
+% This file is part of Dynare.
+%
+% Dynare is free software: you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation, either version 3 of the License, or
+% (at your option) any later version.
+%
+% Dynare is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+
+% Chek number of inputs and outputs.
+if nargin>4 || nargin<3
+    error('A_times_kronecker_B1_Bk takes 3 or 4 input arguments and provides 2 output arguments.')
+end
+if ~iscell(B) || isempty(B)
+    error('A_times_kronecker_B1_Bk: Second input must be a non empty cell array of matrices.')
+end
+if nargin<4
+    folded = 0;
+end
+
+% Get & check dimensions.
+[mA,nA] = size(A);
+k = numel(B);
+m = zeros(1,k);
+n = zeros(1,k);
+for i=1:k
+    [m(i),n(i)] = size(B{i});
+end
+if prod(m) ~= nA
+    error('Input dimension error!')
+end
+if folded
+    for i=2:k
+        if ~isequal(B{i},B{1})
+            error('A_times_kronecker_B1_Bk: The folded output requires equal factors.')
+        end
+    end
+end
+
+% Computational part. D is stored as an array of dimensions [mA, mk, ..., m1] (the index of the first factor
+% varies the slowest in the columns of A), each factor is applied along its own dimension.
+D = reshape(A,[mA, fliplr(m), 1]);
+dims = [mA, fliplr(m)];
+for i=1:k
+    d = k-i+2;
+    perm = [1:d-1, d+1:k+1, d];
+    D = permute(reshape(D,[dims 1]),perm);
+    D = reshape(D,numel(D)/m(i),m(i))*B{i};
+    dims(d) = n(i);
+    D = ipermute(reshape(D,[dims(perm) 1]),perm);
+end
+D = reshape(D,mA,prod(n));
+
+% Selection of the folded columns.
+if folded
+    idx = zeros(k,0);
+    seq = ones(k,1);
+    while true
+        idx(:,end+1) = seq;
+        t = k;
+        while t>0 && seq(t)==n(1)
+            t = t-1;
+        end
+        if ~t
+            break
+        end
+        seq(t:k) = seq(t)+1;
+    end
+    D = D(:,(n(1).^(k-1:-1:0))*(idx-1)+1);
+end
+err = 0;
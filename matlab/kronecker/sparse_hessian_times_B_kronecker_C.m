@@ -33,6 +33,8 @@ function [D, err] = sparse_hessian_times_B_kronecker_C(varargin)
 %! [1] This routine is called by Dynare if and only the mex version is not compiled (also used for testing purposes).
 %! @sp 1
 %! [2] This routine can be called with three or four arguments. In the first case A*kron(B,B) is computed.
+%! @sp 1
+%! [3] If the fourth argument is a logical true, A*kron(B,B) is computed and only the columns (j1,j2) with j1<=j2 are returned (folded form), in lexicographic order.
 %! @sp 2
 %! @strong{This function is called by:}
 %! @sp 1
@@ -69,7 +71,15 @@ B = varargin{2};
 C = varargin{3};
 fake = varargin{nargin};
 
-switch nargin
+% A logical fourth argument asks for A*kron(B,B) in folded form.
+folded = false;
+nargs = nargin;
+if nargin == 4 && islogical(fake)
+    folded = fake;
+    nargs = 3;
+end
+
+switch nargs
   case 4
     [D, fake] = A_times_B_kronecker_C(A,B,C,fake);
   case 3
@@ -77,4 +87,9 @@ switch nargin
   otherwise
     error('Two or Three input arguments required!')
 end
+if folded
+    n = size(B,2);
+    idx = reshape(1:n*n,n,n);
+    D = D(:,idx(tril(true(n))));
+end
 err = 0;
\ No newline at end of file
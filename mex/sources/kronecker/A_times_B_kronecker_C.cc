@@ -33,93 +33,57 @@
 
 #define DEBUG_OMP 0
 
+/*
+ * Maximal size (in doubles) of the workspace of one panel.
+ */
+#define MAX_PANEL_SIZE 4194304
+
+/*
+ * The columns of A are indexed by (rowB,rowC), so A can be seen as a (mA*mC)-by-mB matrix, and the product of this
+ * matrix with B is A*kron(B,I). Its column colB, seen as a mA-by-mC matrix, times C gives the columns
+ * colB*nC,...,(colB+1)*nC-1 of D. The columns of B are processed in panels, so that A is read once per panel instead
+ * of once per column of kron(B,C), and the panels are shared among the threads.
+ */
 void
 full_A_times_kronecker_B_C(double *A, double *B, double *C, double *D,
                            blas_int mA, blas_int nA, blas_int mB, blas_int nB, blas_int mC, blas_int nC, int number_of_threads)
 {
+  blas_int mAmC = mA*mC;
+  blas_int panel = nB;
+#if USE_OMP
+  if (number_of_threads > 1)
+    panel = (nB+number_of_threads-1)/number_of_threads;
+#endif
+  if (panel*mAmC > MAX_PANEL_SIZE)
+    panel = MAX_PANEL_SIZE/mAmC;
+  if (panel < 1)
+    panel = 1;
+  const blas_int number_of_panels = (nB+panel-1)/panel;
 #if USE_OMP
 # pragma omp parallel for num_threads(number_of_threads)
-  for (blas_int colD = 0; colD < nB*nC; colD++)
-    {
-# if DEBUG_OMP
-      mexPrintf("%d thread number is %d (%d).\n", colD, omp_get_thread_num(), omp_get_num_threads());
-# endif
-      blas_int colB = colD/nC;
-      blas_int colC = colD%nC;
-      for (blas_int colA = 0; colA < nA; colA++)
-        {
-          blas_int rowB = colA/mC;
-          blas_int rowC = colA%mC;
-          blas_int idxA = colA*mA;
-          blas_int idxD = colD*mA;
-          double BC = B[colB*mB+rowB]*C[colC*mC+rowC];
-          for (blas_int rowD = 0; rowD < mA; rowD++)
-            {
-              D[idxD+rowD] += A[idxA+rowD]*BC;
-            }
-        }
-    }
-#else
-  const blas_int shiftA = mA*mC;
-  const blas_int shiftD = mA*nC;
-  blas_int kd = 0, ka = 0;
-  char transpose[2] = "N";
-  double one = 1.0;
-  for (blas_int col = 0; col < nB; col++)
+#endif
+  for (blas_int p = 0; p < number_of_panels; p++)
     {
-      ka = 0;
-      for (blas_int row = 0; row < mB; row++)
-        {
-          dgemm(transpose, transpose, &mA, &nC, &mC, &B[mB*col+row], &A[ka], &mA, &C[0], &mC, &one, &D[kd], &mA);
-          ka += shiftA;
-        }
-      kd += shiftD;
-    }
+#if USE_OMP && DEBUG_OMP
+      mexPrintf("%d thread number is %d (%d).\n", p, omp_get_thread_num(), omp_get_num_threads());
 #endif
+      char transpose[2] = "N";
+      double one = 1.0, zero = 0.0;
+      blas_int firstcol = p*panel;
+      blas_int ncols = (nB-firstcol < panel) ? nB-firstcol : panel;
+      // mxMalloc is not thread safe
+      double *F = new double[mAmC*ncols];
+      dgemm(transpose, transpose, &mAmC, &ncols, &mB, &one, A, &mAmC, &B[mB*firstcol], &mB, &zero, F, &mAmC);
+      for (blas_int col = 0; col < ncols; col++)
+        dgemm(transpose, transpose, &mA, &nC, &mC, &one, &F[mAmC*col], &mA, C, &mC, &zero, &D[mA*nC*(firstcol+col)], &mA);
+      delete[] F;
+    }
 }
 
 void
 full_A_times_kronecker_B_B(double *A, double *B, double *D, blas_int mA, blas_int nA, blas_int mB, blas_int nB, int number_of_threads)
 {
-#if USE_OMP
-# pragma omp parallel for num_threads(number_of_threads)
-  for (blas_int colD = 0; colD < nB*nB; colD++)
-    {
-# if DEBUG_OMP
-      mexPrintf("%d thread number is %d (%d).\n", colD, omp_get_thread_num(), omp_get_num_threads());
-# endif
-      blas_int j1B = colD/nB;
-      blas_int j2B = colD%nB;
-      for (blas_int colA = 0; colA < nA; colA++)
-        {
-          blas_int i1B = colA/mB;
-          blas_int i2B = colA%mB;
-          blas_int idxA = colA*mA;
-          blas_int idxD = colD*mA;
-          double BB = B[j1B*mB+i1B]*B[j2B*mB+i2B];
-          for (blas_int rowD = 0; rowD < mA; rowD++)
-            {
-              D[idxD+rowD] += A[idxA+rowD]*BB;
-            }
-        }
-    }
-#else
-  const blas_int shiftA = mA*mB;
-  const blas_int shiftD = mA*nB;
-  blas_int kd = 0, ka = 0;
-  char transpose[2] = "N";
-  double one = 1.0;
-  for (blas_int col = 0; col < nB; col++)
-    {
-      ka = 0;
-      for (blas_int row = 0; row < mB; row++)
-        {
-          dgemm(transpose, transpose, &mA, &nB, &mB, &B[mB*col+row], &A[ka], &mA, &B[0], &mB, &one, &D[kd], &mA);
-          ka += shiftA;
-        }
-      kd += shiftD;
-    }
-#endif
+  full_A_times_kronecker_B_C(A, B, B, D, mA, nA, mB, nB, mB, nB, number_of_threads);
 }
 
 void
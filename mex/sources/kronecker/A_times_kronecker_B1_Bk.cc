@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2007-2012 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This mex file computes A*kron(B1,...,Bk) without explicitly building kron(B1,...,Bk), so that one can consider
+ * third and higher order products of large matrices. It is called as
+ *
+ *   [D, err] = A_times_kronecker_B1_Bk(A, {B1,...,Bk}, number_of_threads)
+ *   [D, err] = A_times_kronecker_B1_Bk(A, {B,...,B}, number_of_threads, folded)
+ *
+ * The factors are applied one at a time, the product with I*...*Bi*...*I (where * is the Kronecker product) being a
+ * sequence of dgemm calls, in the order which minimizes the number of flops (like KronProdAllOptim in Dynare++ which
+ * reorders the factors of a Kronecker product). The rows of A are split into chunks shared among the threads.
+ *
+ * If folded is true, all the factors must be equal, and only the columns (j1,...,jk) of the result with
+ * j1<=...<=jk are returned, in lexicographic order. This is the folded form of the result if the columns of A are
+ * symmetric in (i1,...,ik), as the derivatives of a dsge model are.
+ */
+
+#include <string.h>
+
+#include <vector>
+#include <algorithm>
+
+#include <dynmex.h>
+#include <dynblas.h>
+
+#ifdef USE_OMP
+# include <omp.h>
+#endif
+
+#define DEBUG_OMP 0
+
+/*
+ * Maximal size (in doubles) of the intermediate results of one chunk of rows.
+ */
+#define MAX_CHUNK_SIZE 16777216
+
+struct Factor
+{
+  const double *B;
+  blas_int m, n;
+  double key;
+};
+
+/*
+ * Applying the factor s before t costs less iff 1/m_s-1/n_s < 1/m_t-1/n_t (compare the flops of the two steps in
+ * both orders), so the factors are applied in the increasing order of this key.
+ */
+static bool
+apply_before(const std::pair<double, int> &a, const std::pair<double, int> &b)
+{
+  return a.first < b.first;
+}
+
+/*
+ * Computes the product of the mr rows of A starting at row r0 with kron(B1,...,Bk). On return, the result (mr rows,
+ * leading dimension mr) is in one of the two work arrays, which is returned.
+ */
+static double *
+chunk_times_kronecker(const double *A, blas_int mA, blas_int nA, blas_int r0, blas_int mr,
+                      const std::vector<Factor> &factors, const std::vector<int> &order,
+                      double *work1, double *work2)
+{
+  for (blas_int j = 0; j < nA; j++)
+    memcpy(&work1[j*mr], &A[j*mA+r0], mr*sizeof(double));
+
+  int k = factors.size();
+  std::vector<blas_int> dims(k);
+  for (int t = 0; t < k; t++)
+    dims[t] = factors[t].m;
+
+  char transpose[2] = "N";
+  double one = 1.0, zero = 0.0;
+  double *src = work1, *dst = work2;
+  for (int step = 0; step < k; step++)
+    {
+      int s = order[step];
+      blas_int outer = 1, inner = 1;
+      for (int t = 0; t < s; t++)
+        outer *= dims[t];
+      for (int t = s+1; t < k; t++)
+        inner *= dims[t];
+      blas_int rows = mr*inner;
+      blas_int m = factors[s].m, n = factors[s].n;
+      /*
+      ** A block of src for fixed (c1,...,c{s-1}) is a rows-by-m matrix, rows being indexed by (row of A, c{s+1},...,ck)
+      ** and columns by cs.
+      */
+      for (blas_int o = 0; o < outer; o++)
+        dgemm(transpose, transpose, &rows, &n, &m, &one, &src[o*rows*m], &rows,
+              factors[s].B, &m, &zero, &dst[o*rows*n], &rows);
+      dims[s] = n;
+      std::swap(src, dst);
+    }
+  return src;
+}
+
+/*
+ * Fills cols with the indices of the columns (j1,...,jk), j1<=...<=jk, of kron(B,...,B) in lexicographic order.
+ */
+static void
+folded_columns(int k, blas_int n, std::vector<blas_int> &cols)
+{
+  std::vector<blas_int> seq(k, 0);
+  while (true)
+    {
+      blas_int idx = 0;
+      for (int t = 0; t < k; t++)
+        idx = idx*n + seq[t];
+      cols.push_back(idx);
+      int t = k-1;
+      while (t >= 0 && seq[t] == n-1)
+        t--;
+      if (t < 0)
+        break;
+      seq[t]++;
+      for (int u = t+1; u < k; u++)
+        seq[u] = seq[t];
+    }
+}
+
+void
+full_A_times_kronecker_B1_Bk(const double *A, double *D, blas_int mA, blas_int nA,
+                             const std::vector<Factor> &factors, bool folded, int number_of_threads)
+{
+  int k = factors.size();
+
+  std::vector<std::pair<double, int> > keys(k);
+  for (int t = 0; t < k; t++)
+    keys[t] = std::make_pair(factors[t].key, t);
+  std::stable_sort(keys.begin(), keys.end(), apply_before);
+  std::vector<int> order(k);
+  for (int t = 0; t < k; t++)
+    order[t] = keys[t].second;
+
+  // Largest number of columns of an intermediate result
+  std::vector<blas_int> dims(k);
+  blas_int maxcols = nA;
+  for (int t = 0; t < k; t++)
+    dims[t] = factors[t].m;
+  for (int step = 0; step < k; step++)
+    {
+      dims[order[step]] = factors[order[step]].n;
+      blas_int cols = 1;
+      for (int t = 0; t < k; t++)
+        cols *= dims[t];
+      maxcols = std::max(maxcols, cols);
+    }
+  blas_int ncols = 1;
+  for (int t = 0; t < k; t++)
+    ncols *= factors[t].n;
+
+  std::vector<blas_int> fcols;
+  if (folded)
+    folded_columns(k, factors[0].n, fcols);
+  else
+    for (blas_int j = 0; j < ncols; j++)
+      fcols.push_back(j);
+
+  blas_int chunk = mA;
+#if USE_OMP
+  if (number_of_threads > 1)
+    chunk = (mA+number_of_threads-1)/number_of_threads;
+#endif
+  if (chunk*maxcols > MAX_CHUNK_SIZE)
+    chunk = MAX_CHUNK_SIZE/maxcols;
+  if (chunk < 1)
+    chunk = 1;
+  const blas_int number_of_chunks = (mA+chunk-1)/chunk;
+
+#if USE_OMP
+# pragma omp parallel for num_threads(number_of_threads) schedule(dynamic)
+#endif
+  for (blas_int c = 0; c < number_of_chunks; c++)
+    {
+#if USE_OMP && DEBUG_OMP
+      mexPrintf("%d thread number is %d (%d).\n", c, omp_get_thread_num(), omp_get_num_threads());
+#endif
+      blas_int r0 = c*chunk;
+      blas_int mr = (mA-r0 < chunk) ? mA-r0 : chunk;
+      // mxMalloc is not thread safe
+      double *work1 = new double[mr*maxcols];
+      double *work2 = new double[mr*maxcols];
+      double *res = chunk_times_kronecker(A, mA, nA, r0, mr, factors, order, work1, work2);
+      for (size_t j = 0; j < fcols.size(); j++)
+        memcpy(&D[j*mA+r0], &res[fcols[j]*mr], mr*sizeof(double));
+      delete[] work1;
+      delete[] work2;
+    }
+}
+
+void
+mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+  // Check input and output:
+  if (nrhs > 4 || nrhs < 3)
+    DYN_MEX_FUNC_ERR_MSG_TXT("A_times_kronecker_B1_Bk takes 3 or 4 input arguments and provides 2 output arguments.");
+  if (!mxIsDouble(prhs[0]) || mxIsSparse(prhs[0]))
+    DYN_MEX_FUNC_ERR_MSG_TXT("A_times_kronecker_B1_Bk: First input must be a full matrix of doubles.");
+  if (!mxIsCell(prhs[1]) || mxGetNumberOfElements(prhs[1]) < 1)
+    DYN_MEX_FUNC_ERR_MSG_TXT("A_times_kronecker_B1_Bk: Second input must be a non empty cell array of matrices.");
+
+  // Get & Check dimensions (columns and rows):
+  blas_int mA = mxGetM(prhs[0]);
+  blas_int nA = mxGetN(prhs[0]);
+  int k = mxGetNumberOfElements(prhs[1]);
+  std::vector<Factor> factors(k);
+  blas_int prodm = 1;
+  for (int t = 0; t < k; t++)
+    {
+      const mxArray *Bt = mxGetCell(prhs[1], t);
+      if (!Bt || !mxIsDouble(Bt) || mxIsSparse(Bt))
+        DYN_MEX_FUNC_ERR_MSG_TXT("A_times_kronecker_B1_Bk: The factors must be full matrices of doubles.");
+      factors[t].B = mxGetPr(Bt);
+      factors[t].m = mxGetM(Bt);
+      factors[t].n = mxGetN(Bt);
+      if (factors[t].m == 0 || factors[t].n == 0)
+        DYN_MEX_FUNC_ERR_MSG_TXT("A_times_kronecker_B1_Bk: The factors must not be empty.");
+      factors[t].key = 1.0/factors[t].m - 1.0/factors[t].n;
+      prodm *= factors[t].m;
+    }
+  if (prodm != nA)
+    DYN_MEX_FUNC_ERR_MSG_TXT("Input dimension error!");
+  int numthreads = (int) mxGetScalar(prhs[2]);
+  bool folded = (nrhs == 4 && mxGetScalar(prhs[3]) != 0);
+  if (folded)
+    for (int t = 1; t < k; t++)
+      if (factors[t].m != factors[0].m || factors[t].n != factors[0].n
+          || memcmp(factors[t].B, factors[0].B, factors[0].m*factors[0].n*sizeof(double)))
+        DYN_MEX_FUNC_ERR_MSG_TXT("A_times_kronecker_B1_Bk: The folded output requires equal factors.");
+
+  // Initialization of the ouput:
+  mwSize nD = 1;
+  if (folded)
+    {
+      // number of nondecreasing sequences of length k from n elements, i.e. binomial(n+k-1,k)
+      for (int t = 1; t <= k; t++)
+        nD = nD*(factors[0].n+t-1)/t;
+    }
+  else
+    for (int t = 0; t < k; t++)
+      nD *= factors[t].n;
+  plhs[0] = mxCreateDoubleMatrix(mA, nD, mxREAL);
+  double *D = mxGetPr(plhs[0]);
+  // Computational part:
+  if (mA > 0)
+    full_A_times_kronecker_B1_Bk(mxGetPr(prhs[0]), D, mA, nA, factors, folded, numthreads);
+  plhs[1] = mxCreateDoubleScalar(0);
+}
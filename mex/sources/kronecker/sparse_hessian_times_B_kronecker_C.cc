@@ -21,6 +21,10 @@
  * This mex file computes A*kron(B,C) or A*kron(B,B) without explicitly building kron(B,C) or kron(B,B), so that
  * one can consider large matrices A, B and/or C, and assuming that A is a the hessian of a dsge model
  * (dynare format). This mex file should not be used outside dr1.m.
+ *
+ * Since the hessian is symmetric, the column (i,j) of A is equal to the column (j,i), so only the columns with i<=j
+ * are visited. If the last argument is true (only in the A*kron(B,B) case), the result is returned in the folded
+ * form, i.e. only the columns (j1,j2) of A*kron(B,B) with j1<=j2, in lexicographic order.
  */
 
 #include <string.h>
@@ -33,60 +37,132 @@
 
 #define DEBUG_OMP 0
 
+/*
+ * Number of columns of the result computed in one pass over the non zero elements of A.
+ */
+#define PANEL_WIDTH 32
+
+/*
+ * Computes the columns (j1[p],j2[p]), p=0,...,width-1, of A*kron(B,C) into panel, which is stored row by row (mA
+ * rows of width elements), so that the update for one non zero element of A runs over contiguous memory. The
+ * coefficients of kron(B,C) are computed once for each column of A. If B and C have the same number of rows, the
+ * column (iB,iC) of A with iB<iC also stands for the column (iC,iB), so the coefficients of both are added, and the
+ * columns with iB>iC are skipped.
+ */
+static void
+sparse_hessian_times_panel(const mwIndex *isparseA, const mwIndex *jsparseA, const double *vsparseA,
+                           const double *B, const double *C, mwSize mA, mwSize nA, mwSize mB, mwSize mC,
+                           const mwIndex *j1, const mwIndex *j2, mwSize width, double *coef, double *panel)
+{
+  bool symmetric = (mB == mC);
+  memset(panel, 0, mA*width*sizeof(double));
+  for (mwIndex ii = 0; ii < nA; ii++)
+    {
+      mwIndex k1 = jsparseA[ii];
+      mwIndex k2 = jsparseA[ii+1];
+      if (k1 == k2)
+        continue; // column ii of A does not have non zero elements (and there is nothing to compute).
+      mwIndex iB = ii/mC;
+      mwIndex iC = ii%mC;
+      if (symmetric && iB > iC)
+        continue;
+      for (mwIndex p = 0; p < width; p++)
+        coef[p] = B[j1[p]*mB+iB]*C[j2[p]*mC+iC];
+      if (symmetric && iB < iC)
+        for (mwIndex p = 0; p < width; p++)
+          coef[p] += B[j1[p]*mB+iC]*C[j2[p]*mC+iB];
+      for (mwIndex k = k1; k < k2; k++)
+        {
+          double a = vsparseA[k];
+          double *row = &panel[isparseA[k]*width];
+          for (mwIndex p = 0; p < width; p++)
+            row[p] += a*coef[p];
+        }
+    }
+}
+
+/*
+ * Computes the columns jD[0],...,jD[ncols-1] of D, the column jD[q] being (j1[q],j2[q]) of A*kron(B,C). If mirror is
+ * not NULL, the column is also copied to mirror[q] (if different). The columns are processed in panels which are
+ * shared among the threads.
+ */
+static void
+sparse_hessian_times_columns(const mwIndex *isparseA, const mwIndex *jsparseA, const double *vsparseA,
+                             const double *B, const double *C, double *D, mwSize mA, mwSize nA, mwSize mB, mwSize mC,
+                             const mwIndex *j1, const mwIndex *j2, const mwIndex *jD, const mwIndex *mirror,
+                             mwSize ncols, int number_of_threads)
+{
+  mwSize number_of_panels = (ncols+PANEL_WIDTH-1)/PANEL_WIDTH;
+#if USE_OMP
+# pragma omp parallel num_threads(number_of_threads)
+#endif
+  {
+    // mxMalloc is not thread safe
+    double *coef = new double[PANEL_WIDTH];
+    double *panel = new double[mA*PANEL_WIDTH];
+#if USE_OMP
+# pragma omp for schedule(dynamic)
+#endif
+    for (mwIndex ip = 0; ip < number_of_panels; ip++)
+      {
+#if USE_OMP && DEBUG_OMP
+        mexPrintf("%d thread number is %d (%d).\n", ip, omp_get_thread_num(), omp_get_num_threads());
+#endif
+        mwIndex first = ip*PANEL_WIDTH;
+        mwSize width = (ncols-first < PANEL_WIDTH) ? ncols-first : PANEL_WIDTH;
+        sparse_hessian_times_panel(isparseA, jsparseA, vsparseA, B, C, mA, nA, mB, mC,
+                                   &j1[first], &j2[first], width, coef, panel);
+        for (mwIndex p = 0; p < width; p++)
+          {
+            double *col = &D[jD[first+p]*mA];
+            for (mwIndex kk = 0; kk < mA; kk++)
+              col[kk] = panel[kk*width+p];
+            if (mirror && mirror[first+p] != jD[first+p])
+              memcpy(&D[mirror[first+p]*mA], col, mA*sizeof(double));
+          }
+      }
+    delete[] panel;
+    delete[] coef;
+  }
+}
+
 void
 sparse_hessian_times_B_kronecker_B(mwIndex *isparseA, mwIndex *jsparseA, double *vsparseA,
-                                   double *B, double *D, mwSize mA, mwSize nA, mwSize mB, mwSize nB, int number_of_threads)
+                                   double *B, double *D, mwSize mA, mwSize nA, mwSize mB, mwSize nB, int number_of_threads,
+                                   bool folded)
 {
   /*
-  **   Loop over the columns of kron(B,B) (or of the result matrix D).
-  **   This loop is splitted into two nested loops because we use the
-  **   symmetric pattern of the hessian matrix.
+  **   Only the columns (j1B,j2B) with j1B<=j2B are computed, because we use the
+  **   symmetric pattern of the hessian matrix. In the unfolded result they are
+  **   copied to (j2B,j1B).
   */
-#if USE_OMP
-# pragma omp parallel for num_threads(number_of_threads)
-#endif
+  mwSize ncols = nB*(nB+1)/2;
+  mwIndex *j1 = (mwIndex *) mxMalloc(ncols*sizeof(mwIndex));
+  mwIndex *j2 = (mwIndex *) mxMalloc(ncols*sizeof(mwIndex));
+  mwIndex *jD = (mwIndex *) mxMalloc(ncols*sizeof(mwIndex));
+  mwIndex *mirror = folded ? NULL : (mwIndex *) mxMalloc(ncols*sizeof(mwIndex));
+  mwIndex jj = 0;
   for (mwIndex j1B = 0; j1B < nB; j1B++)
-    {
-#if DEBUG_OMP
-      mexPrintf("%d thread number is %d (%d).\n", j1B, omp_get_thread_num(), omp_get_num_threads());
-#endif
-      for (mwIndex j2B = j1B; j2B < nB; j2B++)
-        {
-          mwIndex jj = j1B*nB+j2B; // column of kron(B,B) index.
-          mwIndex iv = 0;
-          int nz_in_column_ii_of_A = 0;
-          mwIndex k1 = 0;
-          mwIndex k2 = 0;
-          /*
-          ** Loop over the rows of kron(B,B) (column jj).
-          */
-          for (mwIndex ii = 0; ii < nA; ii++)
-            {
-              k1 = jsparseA[ii];
-              k2 = jsparseA[ii+1];
-              if (k1 < k2) // otherwise column ii of A does not have non zero elements (and there is nothing to compute).
-                {
-                  ++nz_in_column_ii_of_A;
-                  mwIndex i1B = (ii/mB);
-                  mwIndex i2B = (ii%mB);
-                  double bb  = B[j1B*mB+i1B]*B[j2B*mB+i2B];
-                  /*
-                  ** Loop over the non zero entries of A(:,ii).
-                  */
-                  for (mwIndex k = k1; k < k2; k++)
-                    {
-                      mwIndex kk = isparseA[k];
-                      D[jj*mA+kk] = D[jj*mA+kk] + bb*vsparseA[iv];
-                      iv++;
-                    }
-                }
-            }
-          if (nz_in_column_ii_of_A > 0)
-            {
-              memcpy(&D[(j2B*nB+j1B)*mA], &D[jj*mA], mA*sizeof(double));
-            }
-        }
-    }
+    for (mwIndex j2B = j1B; j2B < nB; j2B++)
+      {
+        j1[jj] = j1B;
+        j2[jj] = j2B;
+        if (folded)
+          jD[jj] = jj;
+        else
+          {
+            jD[jj] = j1B*nB+j2B;
+            mirror[jj] = j2B*nB+j1B;
+          }
+        jj++;
+      }
+  sparse_hessian_times_columns(isparseA, jsparseA, vsparseA, B, B, D, mA, nA, mB, mB,
+                               j1, j2, jD, mirror, ncols, number_of_threads);
+  mxFree(j1);
+  mxFree(j2);
+  mxFree(jD);
+  if (mirror)
+    mxFree(mirror);
 }
 
 void
@@ -95,48 +171,23 @@ sparse_hessian_times_B_kronecker_C(mwIndex *isparseA, mwIndex *jsparseA, double
                                    mwSize mA, mwSize nA, mwSize mB, mwSize nB, mwSize mC, mwSize nC, int number_of_threads)
 {
   /*
-  **   Loop over the columns of kron(B,B) (or of the result matrix D).
+  **   All the columns of kron(B,C) (or of the result matrix D) are computed.
   */
-#if USE_OMP
-# pragma omp parallel for num_threads(number_of_threads)
-#endif
-  for (mwIndex jj = 0; jj < nB*nC; jj++) // column of kron(B,C) index.
+  mwSize ncols = nB*nC;
+  mwIndex *j1 = (mwIndex *) mxMalloc(ncols*sizeof(mwIndex));
+  mwIndex *j2 = (mwIndex *) mxMalloc(ncols*sizeof(mwIndex));
+  mwIndex *jD = (mwIndex *) mxMalloc(ncols*sizeof(mwIndex));
+  for (mwIndex jj = 0; jj < ncols; jj++)
     {
-      // Uncomment the following line to check if all processors are used.
-#if DEBUG_OMP
-      mexPrintf("%d thread number is %d (%d).\n", jj, omp_get_thread_num(), omp_get_num_threads());
-#endif
-      mwIndex jB = jj/nC;
-      mwIndex jC = jj%nC;
-      mwIndex k1 = 0;
-      mwIndex k2 = 0;
-      mwIndex iv = 0;
-      int nz_in_column_ii_of_A = 0;
-      /*
-      ** Loop over the rows of kron(B,C) (column jj).
-      */
-      for (mwIndex ii = 0; ii < nA; ii++)
-        {
-          k1 = jsparseA[ii];
-          k2 = jsparseA[ii+1];
-          if (k1 < k2) // otherwise column ii of A does not have non zero elements (and there is nothing to compute).
-            {
-              ++nz_in_column_ii_of_A;
-              mwIndex iC = (ii%mB);
-              mwIndex iB = (ii/mB);
-              double cb = C[jC*mC+iC]*B[jB*mB+iB];
-              /*
-              ** Loop over the non zero entries of A(:,ii).
-              */
-              for (mwIndex k = k1; k < k2; k++)
-                {
-                  mwIndex kk = isparseA[k];
-                  D[jj*mA+kk] = D[jj*mA+kk] + cb*vsparseA[iv];
-                  iv++;
-                }
-            }
-        }
+      j1[jj] = jj/nC;
+      j2[jj] = jj%nC;
+      jD[jj] = jj;
     }
+  sparse_hessian_times_columns(isparseA, jsparseA, vsparseA, B, C, D, mA, nA, mB, mC,
+                               j1, j2, jD, NULL, ncols, number_of_threads);
+  mxFree(j1);
+  mxFree(j2);
+  mxFree(jD);
 }
 
 void
@@ -149,13 +200,17 @@ mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
   if (!mxIsSparse(prhs[0]))
     DYN_MEX_FUNC_ERR_MSG_TXT("sparse_hessian_times_B_kronecker_C: First input must be a sparse (dynare) hessian matrix.");
 
+  // A*kron(B,B) in the folded form is asked for by a logical last argument.
+  bool with_C = (nrhs == 4 && !mxIsLogical(prhs[3]));
+  bool folded = (nrhs == 4 && mxIsLogical(prhs[3]) && mxGetScalar(prhs[3]) != 0);
+
   // Get & Check dimensions (columns and rows):
   mwSize mA, nA, mB, nB, mC, nC;
   mA = mxGetM(prhs[0]);
   nA = mxGetN(prhs[0]);
   mB = mxGetM(prhs[1]);
   nB = mxGetN(prhs[1]);
-  if (nrhs == 4) // A*kron(B,C) is to be computed.
+  if (with_C) // A*kron(B,C) is to be computed.
     {
       mC = mxGetM(prhs[2]);
       nC = mxGetN(prhs[2]);
@@ -172,7 +227,7 @@ mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
   int numthreads;
   B = mxGetPr(prhs[1]);
   numthreads = (int) mxGetScalar(prhs[2]);
-  if (nrhs == 4)
+  if (with_C)
     {
       C = mxGetPr(prhs[2]);
       numthreads = (int) mxGetScalar(prhs[3]);
@@ -183,23 +238,27 @@ mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
   double  *vsparseA = mxGetPr(prhs[0]);
   // Initialization of the ouput:
   double *D;
-  if (nrhs == 4)
+  if (with_C)
     {
       plhs[0] = mxCreateDoubleMatrix(mA, nB*nC, mxREAL);
     }
+  else if (folded)
+    {
+      plhs[0] = mxCreateDoubleMatrix(mA, nB*(nB+1)/2, mxREAL);
+    }
   else
     {
       plhs[0] = mxCreateDoubleMatrix(mA, nB*nB, mxREAL);
     }
   D = mxGetPr(plhs[0]);
   // Computational part:
-  if (nrhs == 3)
+  if (with_C)
     {
-      sparse_hessian_times_B_kronecker_B(isparseA, jsparseA, vsparseA, B, D, mA, nA, mB, nB, numthreads);
+      sparse_hessian_times_B_kronecker_C(isparseA, jsparseA, vsparseA, B, C, D, mA, nA, mB, nB, mC, nC, numthreads);
     }
   else
     {
-      sparse_hessian_times_B_kronecker_C(isparseA, jsparseA, vsparseA, B, C, D, mA, nA, mB, nB, mC, nC, numthreads);
+      sparse_hessian_times_B_kronecker_B(isparseA, jsparseA, vsparseA, B, D, mA, nA, mB, nB, numthreads, folded);
     }
   plhs[1] = mxCreateDoubleScalar(0);
 }
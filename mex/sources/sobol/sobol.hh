@@ -171,85 +171,26 @@ ixor(T i, T j)
 }
 
 template<typename T1, typename T2>
-void
-next_sobol(int dim_num, T1 *seed, T2 *quasi)
+T2
+sobol_direction_numbers(int dim_num, int log_max, T1 **v)
 /*
-**  This function generates a new quasirandom Sobol vector with each call.
-**
-**  Discussion:
-**
-**    The routine adapts the ideas of Antonov and Saleev.
-**
-**    This routine uses LONG LONG INT for integers and DOUBLE for real values or
-**                                INT for integers and FLOAT  for real values.
-**
-**    Thanks to Steffan Berridge for supplying (twice) the properly
-**    formatted V data needed to extend the original routine's dimension
-**    limit from 40 to 1111, 05 June 2007.
-**
-**    Thanks to Francis Dalaudier for pointing out that the range of allowed
-**    values of DIM_NUM should start at 1, not 2!  17 February 2009.
-**
-**  Original files downloaded from http://people.sc.fsu.edu/~burkardt/cpp_src/sobol/ (version 17-Feb-2009 09:46)
-**
-**  Reference:
-**
-**    IA Antonov, VM Saleev,
-**    An Economic Method of Computing LP Tau-Sequences,
-**    USSR Computational Mathematics and Mathematical Physics,
-**    Volume 19, 1980, pages 252 - 256.
-**
-**    Paul Bratley, Bennett Fox,
-**    Algorithm 659:
-**    Implementing Sobol's Quasirandom Sequence Generator,
-**    ACM Transactions on Mathematical Software,
-**    Volume 14, Number 1, pages 88-100, 1988.
-**
-**    Bennett Fox,
-**    Algorithm 647:
-**    Implementation and Relative Efficiency of Quasirandom
-**    Sequence Generators,
-**    ACM Transactions on Mathematical Software,
-**    Volume 12, Number 4, pages 362-376, 1986.
-**
-**    Stephen Joe, Frances Kuo
-**    Remark on Algorithm 659:
-**    Implementing Sobol's Quasirandom Sequence Generator,
-**    ACM Transactions on Mathematical Software,
-**    Volume 29, Number 1, pages 49-57, March 2003.
-**
-**    Ilya Sobol,
-**    USSR Computational Mathematics and Mathematical Physics,
-**    Volume 16, pages 236-242, 1977.
-**
-**    Ilya Sobol, YL Levitan,
-**    The Production of Points Uniformly Distributed in a Multidimensional
-**    Cube (in Russian),
-**    Preprint IPM Akad. Nauk SSSR,
-**    Number 40, Moscow 1976.
+**  This function computes the direction numbers of the first DIM_NUM dimensions of the Sobol sequence.
 **
 **  Parameters:
 **
-**    Input, int DIM_NUM, the number of spatial dimensions.
-**    DIM_NUM must satisfy 1 <= DIM_NUM <= 1111.
+**    Input, int DIM_NUM, the number of spatial dimensions, 1 <= DIM_NUM <= DIM_MAX.
 **
-**    Input/output, long long int *SEED, the "seed" for the sequence.
-**    This is essentially the index in the sequence of the quasirandom
-**    value to be generated.  On output, SEED has been set to the
-**    appropriate next value, usually simply SEED+1.
-**    If SEED is less than 0 on input, it is treated as though it were 0.
-**    An input value of 0 requests the first (0-th) element of the sequence.
+**    Input, int LOG_MAX, the number of bits of the direction numbers, LOG_MAX <= sizeof(T1)*8-2.
 **
-**    Output, double QUASI[DIM_NUM], the next quasirandom vector.
+**    Output, T1 **V, DIM_MAX rows of LOG_MAX elements, V[i][j] is the j-th direction number of the i-th dimension
+**    scaled by 2^LOG_MAX.
+**
+**    The function returns RECIPD = 1/2^LOG_MAX, the common denominator of the elements in V.
 */
 {
-  static T1 atmost;
-  static int dim_num_save = 0;
-  int LOG_MAX = sizeof(T1)*8-2;
-  bool includ[LOG_MAX];
-  static bool initialized = false;
-  static T1 lastq[DIM_MAX];
-  static T1 maxcol;
+  T1 atmost;
+  bool includ[log_max];
+  T1 maxcol;
   T1 l = 0;
   static T1 poly[DIM_MAX] =
     {
@@ -366,6 +307,176 @@ next_sobol(int dim_num, T1 *seed, T2 *quasi)
       16209, 16215, 16225, 16259, 16265, 16273, 16299, 16309, 16355, 16375,
       16381
     };
+  initialize_v_array(DIM_MAX, log_max, v);
+  /*
+  **  Set ATMOST = 2^LOG_MAX - 1.
+  */
+  atmost = (T1) 0;
+  for (int i = 1; i <= log_max; i++)
+    atmost = 2 * atmost + 1;
+  /*
+  **  Find the highest 1 bit in ATMOST (should be LOG_MAX).
+  */
+  maxcol = bit_hi1(atmost);
+  /*
+  **  Initialize row 1 of V.
+  */
+  for (T1 j = 0; j < maxcol; j++)
+    {
+      v[0][j] = (T1) 1;
+    }
+  /*
+  **  Initialize the remaining rows of V.
+  */
+  for (int i = 1; i < dim_num; i++)
+    {
+      /*
+      **  The bit pattern of the integer POLY(I) gives the form
+      **  of polynomial I.
+      **
+      **  Find the degree of polynomial I from binary encoding.
+      */
+      T1 j = poly[i];
+      T1 m = 0;
+      while (true)
+        {
+          j = j / 2;
+          if (j <= 0)
+            {
+              break;
+            }
+          m = m + 1;
+        }
+      /*
+      **  We expand this bit pattern to separate components
+      **  of the logical array INCLUD.
+      */
+      j = poly[i];
+      for (T1 k = m-1; 0 <= k; k--)
+        {
+          T1 j2 = j / 2;
+          includ[k] = (j != (2 * j2));
+          j = j2;
+        }
+      /*
+      **  Calculate the remaining elements of row I as explained
+      **  in Bratley and Fox, section 2.
+      **
+      **  Some tricky indexing here.  Did I change it correctly?
+      */
+      for (j = m; j < maxcol; j++)
+        {
+          T1 newv = v[i][j-m];
+          l = 1;
+          for (T1 k = 0; k < m; k++)
+            {
+              l = 2 * l;
+              if (includ[k])
+                {
+                  newv = (newv ^ (l * v[i][j-k-1]));
+                }
+            }
+          v[i][j] = newv;
+        }
+    }
+  /*
+  **  Multiply columns of V by appropriate power of 2.
+  */
+  l = 1;
+  for (T1 j = maxcol - 2; 0 <= j; j--)
+    {
+      l = 2 * l;
+      for (int i = 0; i < dim_num; i++)
+        {
+          v[i][j] = v[i][j] * l;
+        }
+    }
+  /*
+  **  RECIPD is 1/(common denominator of the elements in V).
+  */
+  return 1.0E+00 / ((T2) (2 * l));
+}
+
+template<typename T1, typename T2>
+void
+next_sobol(int dim_num, T1 *seed, T2 *quasi)
+/*
+**  This function generates a new quasirandom Sobol vector with each call.
+**
+**  Discussion:
+**
+**    The routine adapts the ideas of Antonov and Saleev.
+**
+**    This routine uses LONG LONG INT for integers and DOUBLE for real values or
+**                                INT for integers and FLOAT  for real values.
+**
+**    Thanks to Steffan Berridge for supplying (twice) the properly
+**    formatted V data needed to extend the original routine's dimension
+**    limit from 40 to 1111, 05 June 2007.
+**
+**    Thanks to Francis Dalaudier for pointing out that the range of allowed
+**    values of DIM_NUM should start at 1, not 2!  17 February 2009.
+**
+**  Original files downloaded from http://people.sc.fsu.edu/~burkardt/cpp_src/sobol/ (version 17-Feb-2009 09:46)
+**
+**  Reference:
+**
+**    IA Antonov, VM Saleev,
+**    An Economic Method of Computing LP Tau-Sequences,
+**    USSR Computational Mathematics and Mathematical Physics,
+**    Volume 19, 1980, pages 252 - 256.
+**
+**    Paul Bratley, Bennett Fox,
+**    Algorithm 659:
+**    Implementing Sobol's Quasirandom Sequence Generator,
+**    ACM Transactions on Mathematical Software,
+**    Volume 14, Number 1, pages 88-100, 1988.
+**
+**    Bennett Fox,
+**    Algorithm 647:
+**    Implementation and Relative Efficiency of Quasirandom
+**    Sequence Generators,
+**    ACM Transactions on Mathematical Software,
+**    Volume 12, Number 4, pages 362-376, 1986.
+**
+**    Stephen Joe, Frances Kuo
+**    Remark on Algorithm 659:
+**    Implementing Sobol's Quasirandom Sequence Generator,
+**    ACM Transactions on Mathematical Software,
+**    Volume 29, Number 1, pages 49-57, March 2003.
+**
+**    Ilya Sobol,
+**    USSR Computational Mathematics and Mathematical Physics,
+**    Volume 16, pages 236-242, 1977.
+**
+**    Ilya Sobol, YL Levitan,
+**    The Production of Points Uniformly Distributed in a Multidimensional
+**    Cube (in Russian),
+**    Preprint IPM Akad. Nauk SSSR,
+**    Number 40, Moscow 1976.
+**
+**  Parameters:
+**
+**    Input, int DIM_NUM, the number of spatial dimensions.
+**    DIM_NUM must satisfy 1 <= DIM_NUM <= 1111.
+**
+**    Input/output, long long int *SEED, the "seed" for the sequence.
+**    This is essentially the index in the sequence of the quasirandom
+**    value to be generated.  On output, SEED has been set to the
+**    appropriate next value, usually simply SEED+1.
+**    If SEED is less than 0 on input, it is treated as though it were 0.
+**    An input value of 0 requests the first (0-th) element of the sequence.
+**
+**    Output, double QUASI[DIM_NUM], the next quasirandom vector.
+*/
+{
+  static T1 atmost;
+  static int dim_num_save = 0;
+  int LOG_MAX = sizeof(T1)*8-2;
+  static bool initialized = false;
+  static T1 lastq[DIM_MAX];
+  static T1 maxcol;
+  T1 l = 0;
   static T2 recipd;
   static T1 seed_save = -1;
   static T1 **v;
@@ -375,7 +486,6 @@ next_sobol(int dim_num, T1 *seed, T2 *quasi)
       for (int i = 0; i < DIM_MAX; i++)
         v[i] = new T1[LOG_MAX];
       initialized = true;
-      initialize_v_array(DIM_MAX, LOG_MAX, v);
       /*
       **  Check parameters.
       */
@@ -399,83 +509,7 @@ next_sobol(int dim_num, T1 *seed, T2 *quasi)
       **  Find the highest 1 bit in ATMOST (should be LOG_MAX).
       */
       maxcol = bit_hi1(atmost);
-      /*
-      **  Initialize row 1 of V.
-      */
-      for (T1 j = 0; j < maxcol; j++)
-        {
-          v[0][j] = (T1) 1;
-        }
-      /*
-      **  Initialize the remaining rows of V.
-      */
-      for (int i = 1; i < dim_num; i++)
-        {
-          /*
-          **  The bit pattern of the integer POLY(I) gives the form
-          **  of polynomial I.
-          **
-          **  Find the degree of polynomial I from binary encoding.
-          */
-          T1 j = poly[i];
-          T1 m = 0;
-          while (true)
-            {
-              j = j / 2;
-              if (j <= 0)
-                {
-                  break;
-                }
-              m = m + 1;
-            }
-          /*
-          **  We expand this bit pattern to separate components
-          **  of the logical array INCLUD.
-          */
-          j = poly[i];
-          for (T1 k = m-1; 0 <= k; k--)
-            {
-              T1 j2 = j / 2;
-              includ[k] = (j != (2 * j2));
-              j = j2;
-            }
-          /*
-          **  Calculate the remaining elements of row I as explained
-          **  in Bratley and Fox, section 2.
-          **
-          **  Some tricky indexing here.  Did I change it correctly?
-          */
-          for (j = m; j < maxcol; j++)
-            {
-              T1 newv = v[i][j-m];
-              l = 1;
-              for (T1 k = 0; k < m; k++)
-                {
-                  l = 2 * l;
-                  if (includ[k])
-                    {
-                      newv = (newv ^ (l * v[i][j-k-1]));
-                    }
-                }
-              v[i][j] = newv;
-            }
-        }
-      /*
-      **  Multiply columns of V by appropriate power of 2.
-      */
-      l = 1;
-      for (T1 j = maxcol - 2; 0 <= j; j--)
-        {
-          l = 2 * l;
-          for (int i = 0; i < dim_num; i++)
-            {
-              v[i][j] = v[i][j] * l;
-            }
-        }
-      /*
-      **  RECIPD is 1/(common denominator of the elements in V).
-      */
-      recipd = 1.0E+00 / ((T2) (2 * l));
+      recipd = sobol_direction_numbers<T1, T2>(dim_num, LOG_MAX, v);
     }
   if (*seed < 0)
     *seed = 0;
@@ -52,13 +52,13 @@ if test == 1
     disp('')
     disp('Computation of A*kron(B,B) with the mex file (v1):')
     tic 
-    [err, D1] = sparse_hessian_times_B_kronecker_C(A,B,number_of_threads);
+    [D1, err] = sparse_hessian_times_B_kronecker_C(A,B,number_of_threads);
     mexErrCheck('sparse_hessian_times_B_kronecker_C', err);
     toc
     disp('')
     disp('Computation of A*kron(B,B) with the mex file (v2):')
     tic
-    [err, D2] = sparse_hessian_times_B_kronecker_C(A,B,B,number_of_threads);
+    [D2, err] = sparse_hessian_times_B_kronecker_C(A,B,B,number_of_threads);
     mexErrCheck('sparse_hessian_times_B_kronecker_C', err);
     toc
     disp('');
@@ -66,6 +66,18 @@ if test == 1
     if max(max(abs(D1-D2)))>1e-10
         test1_1=0; 
     end
+    disp('')
+    disp('Computation of A*kron(B,B) in folded form with the mex file (v3):')
+    tic
+    [D5, err] = sparse_hessian_times_B_kronecker_C(A,B,number_of_threads,true);
+    mexErrCheck('sparse_hessian_times_B_kronecker_C', err);
+    toc
+    idx = reshape(1:NumberOfColsInB^2,NumberOfColsInB,NumberOfColsInB);
+    disp('');
+    disp(['Difference between D1 and D5 = ' num2str(max(max(abs(D1(:,idx(tril(true(NumberOfColsInB))))-D5))))]);
+    if max(max(abs(D1(:,idx(tril(true(NumberOfColsInB))))-D5)))>1e-10
+        test1_1=0;
+    end
     disp(' ')
     disp('Computation of A*kron(B,B) with two nested loops:')
     tic
@@ -120,13 +132,13 @@ if test==2
     disp(' ')
     disp('Computation of A*kron(B,B) with the mex file (v1):')
     tic
-    [err, D1] = sparse_hessian_times_B_kronecker_C(hessian,zx,number_of_threads);
+    [D1, err] = sparse_hessian_times_B_kronecker_C(hessian,zx,number_of_threads);
     mexErrCheck('sparse_hessian_times_B_kronecker_C', err);
     toc
     disp(' ')
     disp('Computation of A*kron(B,B) with the mex file (v2):')
     tic
-    [err, D2] = sparse_hessian_times_B_kronecker_C(hessian,zx,zx,number_of_threads);
+    [D2, err] = sparse_hessian_times_B_kronecker_C(hessian,zx,zx,number_of_threads);
     mexErrCheck('sparse_hessian_times_B_kronecker_C', err);    
     toc
     disp(' ');
@@ -167,7 +179,7 @@ if test==3
     disp('Test with full format matrix -- 1(a)')
     D1 = A*kron(B,C);
     tic
-    [err, D2] = A_times_B_kronecker_C(A,B,C,number_of_threads);
+    [D2, err] = A_times_B_kronecker_C(A,B,C,number_of_threads);
     mexErrCheck('A_times_B_kronecker_C', err);
     toc
     disp(['Difference between D1 and D2 = ' num2str(max(max(abs(D1-D2))))]);
@@ -177,7 +189,7 @@ if test==3
     disp('Test with full format matrix -- 1(b)')
     D1 = A*kron(B,B);
     tic
-    [err, D2] = A_times_B_kronecker_C(A,B,number_of_threads);
+    [D2, err] = A_times_B_kronecker_C(A,B,number_of_threads);
     mexErrCheck('A_times_B_kronecker_C', err);
     toc
     disp(['Difference between D1 and D2 = ' num2str(max(max(abs(D1-D2))))]);
@@ -187,4 +199,48 @@ if test==3
     if ~(test3_1 && test3_2)
         info = 0;
     end
+end
+
+if test==4
+    test4_1 = 1;
+    test4_2 = 1;
+    A = randn(50,8*9*10);
+    B1 = randn(8,5);
+    B2 = randn(9,12);
+    B3 = randn(10,3);
+    disp('Test with three different matrices -- 1(a)')
+    D1 = A*kron(kron(B1,B2),B3);
+    tic
+    [D2, err] = A_times_kronecker_B1_Bk(A,{B1,B2,B3},number_of_threads);
+    mexErrCheck('A_times_kronecker_B1_Bk', err);
+    toc
+    disp(['Difference between D1 and D2 = ' num2str(max(max(abs(D1-D2))))]);
+    if max(max(abs(D1-D2)))>1e-10
+        test4_1=0;
+    end
+    disp('Test with three equal matrices in folded form -- 1(b)')
+    A = randn(50,1000);
+    B = randn(10,6);
+    D1 = A*kron(kron(B,B),B);
+    tic
+    [D2, err] = A_times_kronecker_B1_Bk(A,{B,B,B},number_of_threads,true);
+    mexErrCheck('A_times_kronecker_B1_Bk', err);
+    toc
+    D3 = zeros(50,56);
+    k = 0;
+    for i1=1:6
+        for i2=i1:6
+            for i3=i2:6
+                k = k+1;
+                D3(:,k) = D1(:,((i1-1)*6+i2-1)*6+i3);
+            end
+        end
+    end
+    disp(['Difference between D1 and D2 = ' num2str(max(max(abs(D3-D2))))]);
+    if max(max(abs(D3-D2)))>1e-10
+        test4_2=0;
+    end
+    if ~(test4_1 && test4_2)
+        info = 0;
+    end
 end
\ No newline at end of file